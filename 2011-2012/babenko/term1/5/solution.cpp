@@ -1,12 +1,33 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <limits>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include <stdexcept>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+#ifdef BENCHMARK
+#include <chrono>
+#endif
 
 enum ParkingEvent {
     EMPTY_PLACE = -2, FULL_PARKING = -1, PLACE_FREED = 0, PLACE_OCCUPIED = 1};
 
 const size_t UNDEFINED_INDEX = std::numeric_limits<size_t>::max();
 
+typedef unsigned long long Word;
+typedef std::vector<Word> Words;
+
+const size_t WORD_BITS = 64;
+
 class FenwickTree
 {
 public:
@@ -28,6 +49,31 @@ public:
         }
     }
 
+    // Builds tree from values in linear time.
+    void assign(const std::vector<int>& values)
+    {
+        tree_ = values;
+        for (size_t index = 0; index < tree_.size(); ++index) {
+            size_t parent = next(index);
+            if (parent < tree_.size()) {
+                tree_[parent] += tree_[index];
+            }
+        }
+    }
+
+    // Restores values in linear time.
+    std::vector<int> values() const
+    {
+        std::vector<int> result = tree_;
+        for (size_t index = result.size(); index > 0; --index) {
+            size_t parent = next(index - 1);
+            if (parent < result.size()) {
+                result[parent] -= result[index - 1];
+            }
+        }
+        return result;
+    }
+
 private:
     int sum(int index) const
     {
@@ -45,20 +91,133 @@ private:
     std::vector<int> tree_;
 };
 
-void readData(size_t& parkingSize, std::vector<int>* operations)
+// Binary event log is a header followed by numEvents int32 values,
+// positive value is arrival to the place, negative one is leaving.
+struct EventLogHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t parkingSize;
+    uint64_t numEvents;
+};
+
+const char EVENT_LOG_MAGIC[4] = {'P', 'R', 'K', 'L'};
+const uint32_t EVENT_LOG_VERSION = 1;
+
+// Number of events read and processed at once.
+const size_t BLOCK_SIZE = 1 << 16;
+
+// Reads events either from text ("+ 5", "- 3") or from binary log.
+class EventReader
 {
-    size_t operationsNumber;
-    std::cin >> parkingSize >> operationsNumber;
-    operations->resize(operationsNumber);
-    for (size_t index = 0; index < operations->size(); ++index) {
-        char sign;
-        std::cin >> sign;
-        int number;
-        std::cin >> number;
-        if (sign == '-') {
-            number = -number;
+public:
+    EventReader(FILE* file, bool binary)
+        : file_(file), binary_(binary), buffer_(1 << 20),
+        position_(0), length_(0), numRead_(0)
+    {
+        if (binary_) {
+            EventLogHeader header;
+            if (fread(&header, sizeof(header), 1, file_) != 1 ||
+                    memcmp(header.magic, EVENT_LOG_MAGIC, 4) != 0 ||
+                    header.version != EVENT_LOG_VERSION) {
+                throw std::runtime_error("Incorrect event log header");
+            }
+            parkingSize_ = header.parkingSize;
+            numEvents_ = header.numEvents;
+        }
+        else {
+            parkingSize_ = readNumber();
+            numEvents_ = readNumber();
+        }
+    }
+
+    size_t parkingSize() const { return parkingSize_; }
+
+    size_t numEvents() const { return numEvents_; }
+
+    // Replaces events with at most maxCount next events.
+    void read(size_t maxCount, std::vector<int>* events)
+    {
+        size_t count = std::min(maxCount, numEvents_ - numRead_);
+        events->resize(count);
+        if (binary_) {
+            std::vector<int32_t> values(count);
+            if (fread(values.data(), sizeof(int32_t), count, file_) != count) {
+                throw std::runtime_error("Unexpected end of event log");
+            }
+            events->assign(values.begin(), values.end());
+        }
+        else {
+            for (size_t index = 0; index < count; ++index) {
+                char sign = nextNonSpace();
+                int number = readNumber();
+                (*events)[index] = sign == '-' ? -number : number;
+            }
+        }
+        numRead_ += count;
+    }
+
+private:
+    int nextChar()
+    {
+        if (position_ == length_) {
+            length_ = fread(buffer_.data(), 1, buffer_.size(), file_);
+            position_ = 0;
+            if (length_ == 0) {
+                return EOF;
+            }
+        }
+        return buffer_[position_++];
+    }
+
+    int nextNonSpace()
+    {
+        int character = nextChar();
+        while (character == ' ' || character == '\n' ||
+               character == '\r' || character == '\t') {
+            character = nextChar();
+        }
+        return character;
+    }
+
+    size_t readNumber()
+    {
+        int character = nextNonSpace();
+        if (character < '0' || character > '9') {
+            throw std::runtime_error("Number expected in event log");
         }
-        (*operations)[index] = number;
+        size_t number = 0;
+        while (character >= '0' && character <= '9') {
+            number = number * 10 + (character - '0');
+            character = nextChar();
+        }
+        return number;
+    }
+
+    FILE* file_;
+    bool binary_;
+    std::vector<char> buffer_;
+    size_t position_;
+    size_t length_;
+    size_t parkingSize_;
+    size_t numEvents_;
+    size_t numRead_;
+};
+
+void convertToBinary(FILE* input, FILE* output)
+{
+    EventReader reader(input, false);
+    EventLogHeader header;
+    memcpy(header.magic, EVENT_LOG_MAGIC, 4);
+    header.version = EVENT_LOG_VERSION;
+    header.parkingSize = reader.parkingSize();
+    header.numEvents = reader.numEvents();
+    fwrite(&header, sizeof(header), 1, output);
+    std::vector<int> events;
+    for (size_t done = 0; done < reader.numEvents(); done += events.size()) {
+        reader.read(BLOCK_SIZE, &events);
+        std::vector<int32_t> values(events.begin(), events.end());
+        fwrite(values.data(), sizeof(int32_t), values.size(), output);
     }
 }
 
@@ -81,29 +240,418 @@ size_t findFirstEmpty(const FenwickTree& tree, size_t begin, size_t end)
     }
 }
 
+// Keeps occupancy of the parking doubled, so that circular search
+// of the first empty place becomes an ordinary binary search.
+class FenwickParking
+{
+public:
+    explicit FenwickParking(size_t parkingSize)
+        : parkingSize_(parkingSize), tree_(2 * parkingSize) { }
+
+    size_t size() const { return parkingSize_; }
+
+    bool isOccupied(size_t place) const
+    {
+        return tree_(place, place + 1) > 0;
+    }
+
+    // Returns first empty place starting from position circularly.
+    size_t findFirstEmpty(size_t position) const
+    {
+        size_t place = ::findFirstEmpty(tree_, position,
+                                        position + parkingSize_);
+        if (place == UNDEFINED_INDEX) {
+            return UNDEFINED_INDEX;
+        }
+        return place % parkingSize_;
+    }
+
+    void occupy(size_t place)
+    {
+        tree_.update(place, 1);
+        tree_.update(place + parkingSize_, 1);
+    }
+
+    void release(size_t place)
+    {
+        tree_.update(place, -1);
+        tree_.update(place + parkingSize_, -1);
+    }
+
+    size_t countEmpty(size_t begin, size_t end) const
+    {
+        return end - begin - tree_(begin, end);
+    }
+
+    // Returns bitset with set bits for empty places.
+    Words emptyPlaces() const
+    {
+        std::vector<int> occupied = tree_.values();
+        Words result((parkingSize_ + WORD_BITS - 1) / WORD_BITS);
+        for (size_t place = 0; place < parkingSize_; ++place) {
+            if (occupied[place] == 0) {
+                result[place / WORD_BITS] |= Word(1) << (place % WORD_BITS);
+            }
+        }
+        return result;
+    }
+
+    void restore(const Words& emptyPlaces)
+    {
+        std::vector<int> occupied(2 * parkingSize_);
+        for (size_t place = 0; place < parkingSize_; ++place) {
+            bool isEmpty =
+                    (emptyPlaces[place / WORD_BITS] >> (place % WORD_BITS)) & 1;
+            if (!isEmpty) {
+                occupied[place] = occupied[place + parkingSize_] = 1;
+            }
+        }
+        tree_.assign(occupied);
+    }
+
+private:
+    size_t parkingSize_;
+    FenwickTree tree_;
+};
+
+// Bitset with summary levels: bit i of a level word is set iff
+// word i of the level below is not zero. The top level is a single
+// word, so the next set bit is found by at most two ctz per level.
+class HierarchicalBitset
+{
+public:
+    explicit HierarchicalBitset(size_t size, bool value = false)
+        : size_(size)
+    {
+        size_t numBits = size;
+        do {
+            size_t numWords = (numBits + WORD_BITS - 1) / WORD_BITS;
+            levels_.push_back(Words(numWords));
+            if (value) {
+                setPrefix(numBits, &levels_.back());
+            }
+            numBits = numWords;
+        } while (numBits > 1);
+    }
+
+    size_t size() const { return size_; }
+
+    bool test(size_t index) const
+    {
+        return (levels_[0][index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+    }
+
+    void set(size_t index)
+    {
+        for (size_t level = 0; level < levels_.size(); ++level) {
+            Word& word = levels_[level][index / WORD_BITS];
+            bool wasZero = word == 0;
+            word |= bit(index % WORD_BITS);
+            if (!wasZero) {
+                break;
+            }
+            index /= WORD_BITS;
+        }
+    }
+
+    void reset(size_t index)
+    {
+        for (size_t level = 0; level < levels_.size(); ++level) {
+            Word& word = levels_[level][index / WORD_BITS];
+            word &= ~bit(index % WORD_BITS);
+            if (word != 0) {
+                break;
+            }
+            index /= WORD_BITS;
+        }
+    }
+
+    // Returns index of the first set bit not less than index.
+    size_t findNext(size_t index) const
+    {
+        size_t level = 0;
+        while (true) {
+            if (level == levels_.size() ||
+                    index / WORD_BITS >= levels_[level].size()) {
+                return UNDEFINED_INDEX;
+            }
+            size_t wordIndex = index / WORD_BITS;
+            Word word = levels_[level][wordIndex] &
+                        (~Word(0) << (index % WORD_BITS));
+            if (word != 0) {
+                index = wordIndex * WORD_BITS + __builtin_ctzll(word);
+                break;
+            }
+            index = wordIndex + 1;
+            ++level;
+        }
+        while (level > 0) {
+            --level;
+            index = index * WORD_BITS + __builtin_ctzll(levels_[level][index]);
+        }
+        return index;
+    }
+
+    // Returns number of set bits in [begin, end).
+    size_t count(size_t begin, size_t end) const
+    {
+        if (begin >= end) {
+            return 0;
+        }
+        const Words& words = levels_[0];
+        size_t first = begin / WORD_BITS;
+        size_t last = (end - 1) / WORD_BITS;
+        Word headMask = ~Word(0) << (begin % WORD_BITS);
+        Word tailMask = ~Word(0) >> (WORD_BITS - 1 - (end - 1) % WORD_BITS);
+        if (first == last) {
+            return __builtin_popcountll(words[first] & headMask & tailMask);
+        }
+        size_t result = __builtin_popcountll(words[first] & headMask) +
+                        __builtin_popcountll(words[last] & tailMask);
+        for (size_t index = first + 1; index < last; ++index) {
+            result += __builtin_popcountll(words[index]);
+        }
+        return result;
+    }
+
+    const Words& words() const { return levels_[0]; }
+
+    // Replaces bits by given words and rebuilds summary levels.
+    void assign(const Words& words)
+    {
+        levels_[0] = words;
+        levels_[0].resize((size_ + WORD_BITS - 1) / WORD_BITS);
+        if (size_ % WORD_BITS != 0) {
+            levels_[0].back() &= bit(size_ % WORD_BITS) - 1;
+        }
+        for (size_t level = 1; level < levels_.size(); ++level) {
+            const Words& lower = levels_[level - 1];
+            Words& upper = levels_[level];
+            std::fill(upper.begin(), upper.end(), 0);
+            for (size_t index = 0; index < lower.size(); ++index) {
+                if (lower[index] != 0) {
+                    upper[index / WORD_BITS] |= bit(index % WORD_BITS);
+                }
+            }
+        }
+    }
+
+private:
+    static Word bit(size_t index) { return Word(1) << index; }
+
+    static void setPrefix(size_t numBits, Words* words)
+    {
+        for (size_t index = 0; index < words->size(); ++index) {
+            size_t rest = numBits - index * WORD_BITS;
+            (*words)[index] = rest >= WORD_BITS ? ~Word(0) : bit(rest) - 1;
+        }
+    }
+
+    size_t size_;
+    std::vector<Words> levels_;
+};
+
+// Stores one bit per place, about parkingSize / 8 bytes in total.
+class BitsetParking
+{
+public:
+    explicit BitsetParking(size_t parkingSize)
+        : emptyPlaces_(parkingSize, true) { }
+
+    size_t size() const { return emptyPlaces_.size(); }
+
+    bool isOccupied(size_t place) const
+    {
+        return !emptyPlaces_.test(place);
+    }
+
+    // Returns first empty place starting from position circularly.
+    size_t findFirstEmpty(size_t position) const
+    {
+        size_t place = emptyPlaces_.findNext(position);
+        if (place == UNDEFINED_INDEX) {
+            place = emptyPlaces_.findNext(0);
+        }
+        return place;
+    }
+
+    void occupy(size_t place) { emptyPlaces_.reset(place); }
+
+    void release(size_t place) { emptyPlaces_.set(place); }
+
+    size_t countEmpty(size_t begin, size_t end) const
+    {
+        return emptyPlaces_.count(begin, end);
+    }
+
+    Words emptyPlaces() const { return emptyPlaces_.words(); }
+
+    void restore(const Words& emptyPlaces) { emptyPlaces_.assign(emptyPlaces); }
+
+private:
+    HierarchicalBitset emptyPlaces_;
+};
+
+// Thread-safe parking split into shards, each one with its own lock.
+// An arrival scans shards circularly starting from the preferred one
+// and skips full shards without locking them, so threads contend only
+// while they are looking at the same shard.
+class ConcurrentParking
+{
+public:
+    static const size_t DEFAULT_SHARD_SIZE = 1 << 16;
+
+    explicit ConcurrentParking(size_t parkingSize,
+                               size_t shardSize = DEFAULT_SHARD_SIZE)
+        : parkingSize_(parkingSize), shardSize_(shardSize),
+        shards_((parkingSize + shardSize - 1) / shardSize)
+    {
+        if (shardSize_ % WORD_BITS != 0) {
+            throw std::invalid_argument(
+                        "Shard size should be a multiple of word size");
+        }
+        for (size_t index = 0; index < shards_.size(); ++index) {
+            Shard& shard = shards_[index];
+            size_t numPlaces =
+                    std::min(shardSize_, parkingSize_ - index * shardSize_);
+            shard.emptyPlaces = HierarchicalBitset(numPlaces, true);
+            shard.numEmpty = numPlaces;
+        }
+    }
+
+    size_t size() const { return parkingSize_; }
+
+    bool isOccupied(size_t place) const
+    {
+        const Shard& shard = shards_[place / shardSize_];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        return !shard.emptyPlaces.test(place % shardSize_);
+    }
+
+    // Every shard is counted under its own lock, so the result is exact
+    // only while no other thread changes the parking.
+    size_t countEmpty(size_t begin, size_t end) const
+    {
+        size_t result = 0;
+        while (begin < end) {
+            const Shard& shard = shards_[begin / shardSize_];
+            size_t shardBegin = begin - begin % shardSize_;
+            size_t shardEnd = std::min(end, shardBegin + shardSize_);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            result += shard.emptyPlaces.count(begin - shardBegin,
+                                              shardEnd - shardBegin);
+            begin = shardEnd;
+        }
+        return result;
+    }
+
+    Words emptyPlaces() const
+    {
+        Words result;
+        for (size_t index = 0; index < shards_.size(); ++index) {
+            const Shard& shard = shards_[index];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            const Words& words = shard.emptyPlaces.words();
+            result.insert(result.end(), words.begin(), words.end());
+        }
+        return result;
+    }
+
+    void restore(const Words& emptyPlaces)
+    {
+        size_t shardWords = shardSize_ / WORD_BITS;
+        for (size_t index = 0; index < shards_.size(); ++index) {
+            Shard& shard = shards_[index];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            size_t begin = std::min(index * shardWords, emptyPlaces.size());
+            size_t end = std::min(begin + shardWords, emptyPlaces.size());
+            shard.emptyPlaces.assign(Words(emptyPlaces.begin() + begin,
+                                           emptyPlaces.begin() + end));
+            shard.numEmpty = shard.emptyPlaces.count(
+                                        0, shard.emptyPlaces.size());
+        }
+    }
+
+    // Finds first empty place starting from position circularly and
+    // occupies it. Returns UNDEFINED_INDEX if the parking is full.
+    size_t arrive(size_t position)
+    {
+        size_t first = position / shardSize_;
+        size_t place = occupyFirstEmpty(first, position % shardSize_,
+                                        shardSize_);
+        for (size_t step = 1;
+                place == UNDEFINED_INDEX && step < shards_.size(); ++step) {
+            place = occupyFirstEmpty((first + step) % shards_.size(), 0,
+                                     shardSize_);
+        }
+        if (place == UNDEFINED_INDEX) {
+            place = occupyFirstEmpty(first, 0, position % shardSize_);
+        }
+        return place;
+    }
+
+    // Returns false if the place was already empty.
+    bool leave(size_t place)
+    {
+        Shard& shard = shards_[place / shardSize_];
+        size_t local = place % shardSize_;
+        std::lock_guard<std::mutex> guard(shard.lock);
+        if (shard.emptyPlaces.test(local)) {
+            return false;
+        }
+        shard.emptyPlaces.set(local);
+        ++shard.numEmpty;
+        return true;
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        Shard() : emptyPlaces(0), numEmpty(0) { }
+
+        mutable std::mutex lock;
+        HierarchicalBitset emptyPlaces;
+        std::atomic<size_t> numEmpty;
+    };
+
+    // Occupies first empty place of the shard in [begin, end).
+    size_t occupyFirstEmpty(size_t shardIndex, size_t begin, size_t end)
+    {
+        Shard& shard = shards_[shardIndex];
+        if (shard.numEmpty.load(std::memory_order_relaxed) == 0) {
+            return UNDEFINED_INDEX;
+        }
+        std::lock_guard<std::mutex> guard(shard.lock);
+        size_t local = shard.emptyPlaces.findNext(begin);
+        if (local == UNDEFINED_INDEX || local >= end) {
+            return UNDEFINED_INDEX;
+        }
+        shard.emptyPlaces.reset(local);
+        --shard.numEmpty;
+        return shardIndex * shardSize_ + local;
+    }
+
+    size_t parkingSize_;
+    size_t shardSize_;
+    std::vector<Shard> shards_;
+};
+
 struct OperationResult
 {
     ParkingEvent event;
     size_t carOccupiedPlace;
 };
 
-OperationResult
-processArrived(int operation, size_t parkingSize, FenwickTree* tree)
+template <class Parking>
+OperationResult processArrived(int operation, Parking* parking)
 {
-    int position = operation - 1;
-    size_t place = findFirstEmpty(*tree, position,
-                               position + parkingSize);
+    size_t position = operation - 1;
+    size_t place = parking->findFirstEmpty(position);
     OperationResult result;
     if (place != UNDEFINED_INDEX) {
-        tree->update(place, 1);
-        if (place < parkingSize) {
-            tree->update(place + parkingSize, 1);
-        }
-        else {
-            tree->update(place - parkingSize, 1);
-        }
+        parking->occupy(place);
         result.event = PLACE_OCCUPIED;
-        result.carOccupiedPlace = place % parkingSize;
+        result.carOccupiedPlace = place;
     }
     else {
         result.event = FULL_PARKING;
@@ -111,14 +659,13 @@ processArrived(int operation, size_t parkingSize, FenwickTree* tree)
     return result;
 }
 
-OperationResult
-processLeaving(int operation, size_t parkingSize, FenwickTree* tree)
+template <class Parking>
+OperationResult processLeaving(int operation, Parking* parking)
 {
-    int position = -operation - 1;
+    size_t position = -operation - 1;
     OperationResult result;
-    if ((*tree)(position, position + 1) > 0) {
-        tree->update(position, -1);
-        tree->update(position + parkingSize, -1);
+    if (parking->isOccupied(position)) {
+        parking->release(position);
         result.event = PLACE_FREED;
     }
     else {
@@ -127,44 +674,453 @@ processLeaving(int operation, size_t parkingSize, FenwickTree* tree)
     return result;
 }
 
-void solve(size_t parkingSize, const std::vector<int>& operations,
+OperationResult processArrived(int operation, ConcurrentParking* parking)
+{
+    OperationResult result;
+    result.carOccupiedPlace = parking->arrive(operation - 1);
+    result.event = result.carOccupiedPlace != UNDEFINED_INDEX ?
+                   PLACE_OCCUPIED : FULL_PARKING;
+    return result;
+}
+
+OperationResult processLeaving(int operation, ConcurrentParking* parking)
+{
+    OperationResult result;
+    result.event = parking->leave(-operation - 1) ?
+                   PLACE_FREED : EMPTY_PLACE;
+    return result;
+}
+
+template <class Parking>
+void solve(const std::vector<int>& operations, Parking* parking,
            std::vector<OperationResult>* result)
 {
-    FenwickTree tree(2 * parkingSize);
     for (size_t index = 0; index < operations.size(); ++index) {
         int operation = operations[index];
         if (operation > 0) {
-            result->push_back(
-                        processArrived(operation, parkingSize, &tree));
+            result->push_back(processArrived(operation, parking));
         }
         else {
-            result->push_back(
-                        processLeaving(operation, parkingSize, &tree));
+            result->push_back(processLeaving(operation, parking));
         }
     }
 }
 
-void outputData(const std::vector<OperationResult>& responses)
+void appendNumber(long long number, std::string* output)
+{
+    char digits[24];
+    size_t length = 0;
+    bool negative = number < 0;
+    unsigned long long value = negative ? -number : number;
+    do {
+        digits[length++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    if (negative) {
+        digits[length++] = '-';
+    }
+    while (length > 0) {
+        output->push_back(digits[--length]);
+    }
+    output->push_back('\n');
+}
+
+void formatData(const std::vector<OperationResult>& responses,
+                std::string* output)
 {
     for (size_t index = 0; index < responses.size(); ++index) {
         if (responses[index].event == PLACE_OCCUPIED) {
-            std::cout << responses[index].carOccupiedPlace + 1 << std::endl;
+            appendNumber(responses[index].carOccupiedPlace + 1, output);
         }
         else {
-            std::cout << responses[index].event << std::endl;
+            appendNumber(responses[index].event, output);
+        }
+    }
+}
+
+void outputData(const std::vector<OperationResult>& responses)
+{
+    std::string output;
+    formatData(responses, &output);
+    fwrite(output.data(), 1, output.size(), stdout);
+}
+
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity_(capacity), closed_(false) { }
+
+    void push(T value)
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        notFull_.wait(guard, [this]() { return items_.size() < capacity_; });
+        items_.push_back(std::move(value));
+        notEmpty_.notify_one();
+    }
+
+    // Returns false if the queue is closed and nothing is left.
+    bool pop(T* value)
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        notEmpty_.wait(guard, [this]() {
+            return !items_.empty() || closed_;
+        });
+        if (items_.empty()) {
+            return false;
         }
+        *value = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex lock_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+// Snapshot is a header followed by the bitset of empty places.
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t parkingSize;
+};
+
+const char SNAPSHOT_MAGIC[4] = {'P', 'R', 'K', 'S'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+// Writes to a temporary file first, so that a crash while saving
+// never spoils the previous snapshot.
+template <class Parking>
+void saveSnapshot(const Parking& parking, const std::string& path)
+{
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.parkingSize = parking.size();
+    Words emptyPlaces = parking.emptyPlaces();
+    std::string temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (file == NULL) {
+        throw std::runtime_error("Cannot open " + temporaryPath);
+    }
+    bool written =
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(emptyPlaces.data(), sizeof(Word), emptyPlaces.size(), file) ==
+                                                        emptyPlaces.size();
+    if (fclose(file) != 0 || !written ||
+            rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot write snapshot " + path);
+    }
+}
+
+template <class Parking>
+void loadSnapshot(const std::string& path, Parking* parking)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        throw std::runtime_error("Cannot open " + path);
     }
+    SnapshotHeader header;
+    Words emptyPlaces((parking->size() + WORD_BITS - 1) / WORD_BITS);
+    bool correct =
+        fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, SNAPSHOT_MAGIC, 4) == 0 &&
+        header.version == SNAPSHOT_VERSION &&
+        header.parkingSize == parking->size() &&
+        fread(emptyPlaces.data(), sizeof(Word), emptyPlaces.size(), file) ==
+                                                        emptyPlaces.size();
+    fclose(file);
+    if (!correct) {
+        throw std::runtime_error("Incorrect snapshot " + path);
+    }
+    parking->restore(emptyPlaces);
 }
 
-int main()
+// Saves snapshot after every period processed events, checked at block
+// boundaries, and once more when all events are processed.
+template <class Parking>
+class Checkpointer
 {
-    std::ios_base::sync_with_stdio(false);
+public:
+    Checkpointer(const std::string& path, size_t period,
+                 const Parking* parking)
+        : path_(path), period_(period), numEvents_(0), parking_(parking) { }
+
+    void advance(size_t numEvents)
+    {
+        numEvents_ += numEvents;
+        if (!path_.empty() && period_ > 0 && numEvents_ >= period_) {
+            saveSnapshot(*parking_, path_);
+            numEvents_ = 0;
+        }
+    }
+
+    void finish()
+    {
+        if (!path_.empty()) {
+            saveSnapshot(*parking_, path_);
+        }
+    }
+
+private:
+    std::string path_;
+    size_t period_;
+    size_t numEvents_;
+    const Parking* parking_;
+};
+
+// Parses, processes and formats blocks of events in three threads.
+template <class Parking>
+void runPipeline(EventReader* reader, Parking* parking,
+                 Checkpointer<Parking>* checkpointer)
+{
+    static const size_t QUEUE_CAPACITY = 4;
+    static const size_t OUTPUT_BLOCK_SIZE = 1 << 22;
+
+    BoundedQueue<std::vector<int> > operationsQueue(QUEUE_CAPACITY);
+    BoundedQueue<std::vector<OperationResult> > responsesQueue(
+                                                            QUEUE_CAPACITY);
+
+    std::thread parser([reader, &operationsQueue]() {
+        std::vector<int> operations;
+        for (size_t done = 0; done < reader->numEvents();
+                                            done += operations.size()) {
+            reader->read(BLOCK_SIZE, &operations);
+            operationsQueue.push(operations);
+        }
+        operationsQueue.close();
+    });
+    std::thread formatter([&responsesQueue]() {
+        std::vector<OperationResult> responses;
+        std::string output;
+        while (responsesQueue.pop(&responses)) {
+            formatData(responses, &output);
+            if (output.size() >= OUTPUT_BLOCK_SIZE) {
+                fwrite(output.data(), 1, output.size(), stdout);
+                output.clear();
+            }
+        }
+        fwrite(output.data(), 1, output.size(), stdout);
+    });
 
-    size_t parkingSize;
     std::vector<int> operations;
-    readData(parkingSize, &operations);
-    std::vector<OperationResult> queryResponses;
-    solve(parkingSize, operations, &queryResponses);
-    outputData(queryResponses);
+    while (operationsQueue.pop(&operations)) {
+        std::vector<OperationResult> responses;
+        responses.reserve(operations.size());
+        solve(operations, parking, &responses);
+        responsesQueue.push(std::move(responses));
+        checkpointer->advance(operations.size());
+    }
+    responsesQueue.close();
+    parser.join();
+    formatter.join();
+}
+
+struct Options
+{
+    Options()
+        : binary(false), pipeline(false), checkpointPeriod(0),
+        countEmpty(false), firstPlace(0), lastPlace(0) { }
+
+    std::string engine;
+    bool binary;
+    bool pipeline;
+    std::string restorePath;
+    std::string snapshotPath;
+    size_t checkpointPeriod;
+    bool countEmpty;
+    size_t firstPlace;
+    size_t lastPlace;
+};
+
+template <class Parking>
+void run(const Options& options, EventReader* reader, Parking* parking)
+{
+    if (!options.restorePath.empty()) {
+        loadSnapshot(options.restorePath, parking);
+    }
+    Checkpointer<Parking> checkpointer(options.snapshotPath,
+                                       options.checkpointPeriod, parking);
+    if (options.pipeline) {
+        runPipeline(reader, parking, &checkpointer);
+    }
+    else {
+        std::vector<OperationResult> queryResponses;
+        queryResponses.reserve(reader->numEvents());
+        std::vector<int> operations;
+        for (size_t done = 0; done < reader->numEvents();
+                                            done += operations.size()) {
+            reader->read(BLOCK_SIZE, &operations);
+            solve(operations, parking, &queryResponses);
+            checkpointer.advance(operations.size());
+        }
+        outputData(queryResponses);
+    }
+    checkpointer.finish();
+    if (options.countEmpty) {
+        if (options.firstPlace < 1 || options.firstPlace > options.lastPlace ||
+                options.lastPlace > parking->size()) {
+            throw std::invalid_argument("Incorrect range of places");
+        }
+        std::string output;
+        appendNumber(parking->countEmpty(options.firstPlace - 1,
+                                         options.lastPlace), &output);
+        fwrite(output.data(), 1, output.size(), stdout);
+    }
+}
+
+#ifdef BENCHMARK
+unsigned long long nextRandom(unsigned long long* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Every thread sends half arrivals and half leavings to random places
+// of random lots. Returns number of processed events per second.
+double measureThroughput(const std::vector<ConcurrentParking*>& lots,
+                         size_t numThreads, size_t numEventsPerThread)
+{
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start =
+                                        std::chrono::steady_clock::now();
+    for (size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+        threads.push_back(std::thread([&lots, numEventsPerThread,
+                                       threadIndex]() {
+            unsigned long long state =
+                            0x9E3779B97F4A7C15ULL * (threadIndex + 1);
+            for (size_t index = 0; index < numEventsPerThread; ++index) {
+                unsigned long long random = nextRandom(&state);
+                ConcurrentParking* lot = lots[(random >> 40) % lots.size()];
+                size_t place = (random >> 1) % lot->size();
+                if (random & 1) {
+                    lot->arrive(place);
+                }
+                else {
+                    lot->leave(place);
+                }
+            }
+        }));
+    }
+    for (size_t index = 0; index < threads.size(); ++index) {
+        threads[index].join();
+    }
+    double seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start).count();
+    return numThreads * numEventsPerThread / seconds;
+}
+
+void benchmark(size_t numLots, size_t lotSize)
+{
+    static const size_t NUM_EVENTS_PER_THREAD = 2000000;
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << numLots << " lot(s) of " << lotSize << " places"
+              << std::endl;
+    for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        std::vector<ConcurrentParking*> lots;
+        for (size_t index = 0; index < numLots; ++index) {
+            lots.push_back(new ConcurrentParking(lotSize));
+        }
+        double throughput = measureThroughput(lots, numThreads,
+                                              NUM_EVENTS_PER_THREAD);
+        std::cout << "  threads " << numThreads << ": "
+                  << static_cast<size_t>(throughput) << " events/s"
+                  << std::endl;
+        for (size_t index = 0; index < lots.size(); ++index) {
+            delete lots[index];
+        }
+    }
+}
+#endif
+
+// Usage: solution [--fenwick | --sharded] [--binary] [--pipeline]
+//                 [--restore=FILE] [--snapshot=FILE] [--checkpoint=N]
+//                 [--count-empty=FIRST:LAST]
+//        solution --convert < text_log > binary_log
+// Bitset engine is used by default, --fenwick selects the Fenwick tree
+// and --sharded selects the thread-safe sharded parking. --binary reads
+// binary event log, --pipeline parses, processes and writes events in
+// separate threads. --restore starts from a saved snapshot instead of
+// the empty parking, --snapshot saves the state when all events are
+// processed and, with --checkpoint, after every N events.
+// --count-empty prints the number of empty places among places FIRST
+// to LAST after all events.
+int main(int argc, char* argv[])
+{
+#ifdef BENCHMARK
+    benchmark(1, 10000000);
+    benchmark(1000, 10000);
+#else
+    Options options;
+    for (int index = 1; index < argc; ++index) {
+        std::string option = argv[index];
+        std::string value = option.substr(option.find('=') + 1);
+        if (option == "--convert") {
+            convertToBinary(stdin, stdout);
+            return 0;
+        }
+        else if (option == "--binary") {
+            options.binary = true;
+        }
+        else if (option == "--pipeline") {
+            options.pipeline = true;
+        }
+        else if (option.compare(0, 10, "--restore=") == 0) {
+            options.restorePath = value;
+        }
+        else if (option.compare(0, 11, "--snapshot=") == 0) {
+            options.snapshotPath = value;
+        }
+        else if (option.compare(0, 13, "--checkpoint=") == 0) {
+            options.checkpointPeriod = atol(value.c_str());
+        }
+        else if (option.compare(0, 14, "--count-empty=") == 0) {
+            options.countEmpty = true;
+            if (sscanf(value.c_str(), "%zu:%zu", &options.firstPlace,
+                       &options.lastPlace) != 2) {
+                std::cerr << "Incorrect range " << value << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--fenwick" || option == "--sharded") {
+            options.engine = option;
+        }
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    EventReader reader(stdin, options.binary);
+    if (options.engine == "--fenwick") {
+        FenwickParking parking(reader.parkingSize());
+        run(options, &reader, &parking);
+    }
+    else if (options.engine == "--sharded") {
+        ConcurrentParking parking(reader.parkingSize());
+        run(options, &reader, &parking);
+    }
+    else {
+        BitsetParking parking(reader.parkingSize());
+        run(options, &reader, &parking);
+    }
+#endif
     return 0;
 }
@@ -1,11 +1,13 @@
 #include <iostream>
-#include <queue>
 #include <vector>
 #include <utility>
 #include <string>
 #include <stdexcept>
 #include <algorithm>
-#include <memory>
+#include <limits>
+#include <stdint.h>
+#include <cstdlib>
+#include <ctime>
 
 void require(bool cond, const std::string& message)
 {
@@ -14,15 +16,14 @@ void require(bool cond, const std::string& message)
     }
 }
 
-#define SIZE(node) ((node) == NULL ? 0 : (node)->size())
-#define EMPTY_TREE NULL
-
 template <class Key, class Value>
 class Element
 {
 public:
     typedef Key KeyType;
     typedef Value ValueType;
+    Element() : key_(), value_() { }
+
     Element(Key key, Value value) : key_(key), value_(value) { }
 
     Key key() const { return key_; }
@@ -34,36 +35,48 @@ private:
     Value value_;
 };
 
+typedef uint32_t NodeIndex;
+
+const NodeIndex EMPTY_TREE = 0;
+
+// Node keeps pending operations for its children: the node itself
+// is already reversed (children swapped) and filled when they are set,
+// so pending fill value is the value of the node. Flags share a word
+// with the size, which keeps Node<Element<int, char> > in 20 bytes.
 template <class Element>
 class Node
 {
 public:
-    typedef Node<Element> Type;
-    typedef Type* NodePointer;
+    typedef NodeIndex Index;
+    typedef typename Element::ValueType Value;
+
+    static const size_t MAX_SIZE = (1 << 30) - 1;
+
+    // constructs node of the empty tree
+    Node()
+        : leftChild_(EMPTY_TREE), rightChild_(EMPTY_TREE), size_(0),
+        reversed_(false), filled_(false) { }
 
-    explicit Node(const Element& element, NodePointer leftChild = EMPTY_TREE,
-                  NodePointer rightChild = EMPTY_TREE,
-                  NodePointer parent = EMPTY_TREE)
-        : element_(element), leftChild_(leftChild),
-        rightChild_(rightChild), parent_(parent), size_(1) { }
+    explicit Node(const Element& element)
+        : element_(element), leftChild_(EMPTY_TREE),
+        rightChild_(EMPTY_TREE), size_(1), reversed_(false), filled_(false)
+    { }
 
     const Element& element() const { return element_; }
 
-    void setLeftChild(NodePointer node)
-    {
-        leftChild_ = node;
-        updateSize();
-    }
+    void setElement(const Element& element) { element_ = element; }
 
-    NodePointer leftChild() const { return leftChild_; }
+    void setLeftChild(Index node) { leftChild_ = node; }
 
-    void setRightChild(NodePointer node)
-    {
-        rightChild_ = node;
-        updateSize();
-    }
+    Index leftChild() const { return leftChild_; }
+
+    void setRightChild(Index node) { rightChild_ = node; }
 
-    NodePointer rightChild() const { return rightChild_; }
+    Index rightChild() const { return rightChild_; }
+
+    Index* leftChildLink() { return &leftChild_; }
+
+    Index* rightChildLink() { return &rightChild_; }
 
     size_t size() const { return size_; }
 
@@ -75,206 +88,499 @@ public:
                rightChild_ == EMPTY_TREE;
     }
 
-    static NodePointer instance(const Element& element)
+    bool hasPending() const { return reversed_ | filled_; }
+
+    bool reversed() const { return reversed_; }
+
+    void reverse()
     {
-        return new Node<Element>(element);
+        std::swap(leftChild_, rightChild_);
+        reversed_ = !reversed_;
     }
 
-private:
-    void updateSize()
+    bool filled() const { return filled_; }
+
+    Value fillValue() const { return element_.value(); }
+
+    void fill(const Value& value)
+    {
+        element_ = Element(element_.key(), value);
+        filled_ = true;
+    }
+
+    void clearPending()
     {
-        size_ = SIZE(leftChild_) + SIZE(rightChild_) + 1;
+        reversed_ = false;
+        filled_ = false;
     }
 
+private:
     Element element_;
-    NodePointer leftChild_;
-    NodePointer rightChild_;
-    NodePointer parent_;
-    size_t size_;
+    Index leftChild_;
+    Index rightChild_;
+    uint32_t size_ : 30;
+    uint32_t reversed_ : 1;
+    uint32_t filled_ : 1;
 };
 
-
-template <class Element>
-class CartesianTree;
-
-// for conversion
-template <class Element>
-class CartesianTreeRef
+// Arena of nodes addressed by 32-bit indices. Index EMPTY_TREE refers
+// to a sentinel node of size 0. Nodes are allocated in blocks and
+// never move, so references to them stay valid while new nodes are
+// created. Destroyed nodes are reused by next created ones, all nodes
+// are released together with the pool.
+template <class NodeType>
+class NodePool
 {
 public:
-    typedef typename Node<Element>::NodePointer NodePointer;
-    typedef typename Node<Element>::Type Node;
-    typedef NodePointer Tree;
-    typedef std::auto_ptr<Node> Root;
+    typedef typename NodeType::Index Index;
 
-    explicit CartesianTreeRef(Root root)
-    : tree_(root.release()) { }
+    NodePool() : numNodes_(0)
+    {
+        clear();
+    }
+
+    Index create(const NodeType& node)
+    {
+        if (!freeNodes_.empty()) {
+            Index result = freeNodes_.back();
+            freeNodes_.pop_back();
+            (*this)[result] = node;
+            return result;
+        }
+        require(numNodes_ <= NodeType::MAX_SIZE, "Node pool is exhausted");
+        if (numNodes_ % BLOCK_SIZE == 0) {
+            blocks_.push_back(std::vector<NodeType>());
+            blocks_.back().reserve(BLOCK_SIZE);
+        }
+        blocks_.back().push_back(node);
+        return numNodes_++;
+    }
+
+    // Creates a copy of the node referring to the same children.
+    Index clone(Index index)
+    {
+        NodeType node = (*this)[index];
+        return create(node);
+    }
+
+    void destroy(Index index)
+    {
+        freeNodes_.push_back(index);
+    }
+
+    NodeType& operator[](Index index)
+    {
+        return blocks_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    }
 
-    Tree get() const
+    const NodeType& operator[](Index index) const
     {
-        return tree_;
+        return blocks_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    }
+
+    size_t size(Index index) const { return (*this)[index].size(); }
+
+    size_t numNodes() const { return numNodes_ - freeNodes_.size() - 1; }
+
+    void clear()
+    {
+        blocks_.clear();
+        freeNodes_.clear();
+        blocks_.push_back(std::vector<NodeType>());
+        blocks_.back().reserve(BLOCK_SIZE);
+        blocks_.back().push_back(NodeType());
+        numNodes_ = 1;
     }
 
 private:
-    Tree tree_;
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    std::vector<std::vector<NodeType> > blocks_;
+    std::vector<Index> freeNodes_;
+    size_t numNodes_;
 };
 
+// Handle to a tree which nodes are owned by a NodePool, copying
+// the handle does not copy nodes. All trees merged together should
+// belong to the same pool. Persistent tree copies every node it
+// changes, so trees sharing nodes with it are left intact.
 template <class Element>
 class CartesianTree
 {
 public:
-    typedef typename Node<Element>::NodePointer NodePointer;
-    typedef typename Node<Element>::Type Node;
-    typedef NodePointer Tree;
+    typedef ::Node<Element> Node;
+    typedef NodePool<Node> Pool;
+    typedef typename Pool::Index Tree;
     typedef std::pair<Tree, Tree> TreesPair;
     typedef CartesianTree<Element> Type;
-    typedef std::auto_ptr<Node> Root;
+    typedef typename Node::Value Value;
 
-    explicit CartesianTree() { }
+    explicit CartesianTree(Pool* pool, Tree tree = EMPTY_TREE,
+                           bool persistent = false)
+        : pool_(pool), root_(tree), persistent_(persistent) { }
 
-    explicit CartesianTree(const std::vector<Element>& elements)
+    CartesianTree(Pool* pool, const std::vector<Element>& elements)
+        : pool_(pool), root_(EMPTY_TREE), persistent_(false)
     {
-        build();
+        build(elements);
     }
 
-    // it does own pointer like std::auto_ptr
-    explicit CartesianTree(Tree tree) : root_(tree) { }
-
-    explicit CartesianTree(Type& other) : root_(other.release()) { }
+    Tree root() const { return root_; }
 
-    CartesianTree(CartesianTreeRef<Element> ref)
-    : root_(ref.get()) { }
+    Tree release()
+    {
+        Tree tree = root_;
+        root_ = EMPTY_TREE;
+        return tree;
+    }
 
-    operator CartesianTreeRef<Element>()
+    void insert(size_t index, const Element& element)
     {
-        return CartesianTreeRef<Element>(root_);
+        Tree innerTree = pool_->create(Node(element));
+        TreesPair splitPair = split(release(), index);
+        root_ = merge(splitPair.first, merge(innerTree, splitPair.second));
     }
 
-    Tree release()
+    void append(const Element& element)
     {
-        return root_.release();
+        insert(size(), element);
     }
 
-    ~CartesianTree()
+    Element find(size_t index) const
     {
-        if (root_.get() == EMPTY_TREE) {
-            return;
-        }
-        std::queue<NodePointer> nodes;
-        nodes.push(root_.release());
-        while (!nodes.empty()) {
-            NodePointer node = nodes.front();
-            nodes.pop();
-            if (node->leftChild() != EMPTY_TREE) {
-                nodes.push(node->leftChild());
+        require(index < size(), "Index is out of range");
+        Cursor cursor(root_);
+        while (true) {
+            size_t leftSize = size(child(cursor, true).tree);
+            if (leftSize > index) {
+                cursor = child(cursor, true);
+            }
+            else if (leftSize == index) {
+                return element(cursor);
             }
-            if (node->rightChild() != EMPTY_TREE) {
-                nodes.push(node->rightChild());
+            else {
+                index -= leftSize + 1;
+                cursor = child(cursor, false);
             }
-            delete node;
         }
     }
 
-    void insert(size_t index, const Element& element)
+    // Reverses order of elements lazily.
+    void reverse()
     {
-        TreesPair splitPair = split(root_.release(), index);
-        Tree innerTree = Node::instance(element);
-        root_.reset(merge(splitPair.first,
-                    merge(innerTree, splitPair.second)));
+        if (root_ != EMPTY_TREE) {
+            root_ = modifiable(root_);
+            node(root_).reverse();
+        }
     }
 
-    void append(const Element& element)
+    // Replaces values of all elements lazily.
+    void fill(const Value& value)
     {
-        insert(size(), element);
+        if (root_ != EMPTY_TREE) {
+            root_ = modifiable(root_);
+            node(root_).fill(value);
+        }
+    }
+
+    size_t size() const { return pool_->size(root_); }
+
+    // Replaces element at index, element key should be the same.
+    void replace(size_t index, const Element& element)
+    {
+        require(index < size(), "Index is out of range");
+        Tree* link = &root_;
+        while (true) {
+            *link = modifiable(*link);
+            pushDown(*link);
+            Node& current = node(*link);
+            size_t leftSize = size(current.leftChild());
+            if (leftSize > index) {
+                link = current.leftChildLink();
+            }
+            else if (leftSize == index) {
+                current.setElement(element);
+                return;
+            }
+            else {
+                index -= leftSize + 1;
+                link = current.rightChildLink();
+            }
+        }
     }
 
-    const Tree find(size_t index) const
+    // Calls function for every element in order, O(size) in total.
+    template <class Function>
+    void forEach(Function function) const
     {
-        return find(root_.get(), index);
+        std::vector<Cursor> path;
+        Cursor cursor(root_);
+        while (cursor.tree != EMPTY_TREE || !path.empty()) {
+            while (cursor.tree != EMPTY_TREE) {
+                path.push_back(cursor);
+                cursor = child(cursor, true);
+            }
+            cursor = path.back();
+            path.pop_back();
+            function(element(cursor));
+            cursor = child(cursor, false);
+        }
     }
 
-    size_t size() const { return SIZE(root_.get()); }
+    // Replaces values of elements by values given in order, keeping
+    // keys and the shape of the tree, in O(size).
+    void setValues(const Value* values)
+    {
+        std::vector<Tree*> path;
+        Tree* link = &root_;
+        while (*link != EMPTY_TREE || !path.empty()) {
+            while (*link != EMPTY_TREE) {
+                *link = modifiable(*link);
+                pushDown(*link);
+                path.push_back(link);
+                link = node(*link).leftChildLink();
+            }
+            Node& current = node(*path.back());
+            path.pop_back();
+            current.setElement(Element(current.element().key(), *values++));
+            link = current.rightChildLink();
+        }
+    }
 
     Type split(size_t index)
     {
-        TreesPair result = split(root_.release(), index);
-        root_.reset(result.first);
-        return Type(result.second);
+        TreesPair result = split(release(), index);
+        root_ = result.first;
+        return Type(pool_, result.second, persistent_);
     }
 
     void merge(Type tree)
     {
-        root_.reset(merge(root_.release(), tree.release()));
+        require(pool_ == tree.pool_, "Cannot merge trees of different pools");
+        root_ = merge(release(), tree.release());
     }
 
 private:
-    const Tree find(Tree tree, size_t index) const
+    Node& node(Tree tree) const { return (*pool_)[tree]; }
+
+    size_t size(Tree tree) const { return pool_->size(tree); }
+
+    void updateSize(Tree tree) const
     {
-        require(tree != EMPTY_TREE, "Index is out of range");
-        if (tree->isLeaf()) {
-            return tree;
-        }
-        if (SIZE(tree->leftChild()) > index) {
-            return find(tree->leftChild(), index);
+        Node& current = node(tree);
+        current.setSize(size(current.leftChild()) +
+                        size(current.rightChild()) + 1);
+    }
+
+    // Returns node which can be changed.
+    Tree modifiable(Tree tree) const
+    {
+        return persistent_ ? pool_->clone(tree) : tree;
+    }
+
+    // Position in the tree for reading without applying pending
+    // operations of ancestors: they are carried down instead.
+    struct Cursor
+    {
+        explicit Cursor(Tree treeIn)
+            : tree(treeIn), reversed(false), filled(false), fill() { }
+
+        Tree tree;
+        bool reversed;
+        bool filled;
+        Value fill;
+    };
+
+    Cursor child(const Cursor& cursor, bool left) const
+    {
+        const Node& current = node(cursor.tree);
+        Cursor result(left != cursor.reversed ? current.leftChild() :
+                                                current.rightChild());
+        result.reversed = cursor.reversed != current.reversed();
+        result.filled = cursor.filled || current.filled();
+        result.fill = cursor.filled ? cursor.fill : current.fillValue();
+        return result;
+    }
+
+    Element element(const Cursor& cursor) const
+    {
+        const Element& element = node(cursor.tree).element();
+        if (!cursor.filled) {
+            return element;
         }
-        else if (SIZE(tree->leftChild()) == index) {
-            return tree;
+        return Element(element.key(), cursor.fill);
+    }
+
+    // Passes pending operations of the node to its children.
+    void pushDown(Tree tree) const
+    {
+        Node& current = node(tree);
+        if (current.hasPending()) {
+            pushPendingToChildren(current);
         }
-        else {
-            return find(tree->rightChild(),
-                        index - SIZE(tree->leftChild()) - 1);
+    }
+
+    void pushPendingToChildren(Node& current) const
+    {
+        Tree children[] = {current.leftChild(), current.rightChild()};
+        for (size_t index = 0; index < 2; ++index) {
+            if (children[index] == EMPTY_TREE) {
+                continue;
+            }
+            children[index] = modifiable(children[index]);
+            if (current.reversed()) {
+                node(children[index]).reverse();
+            }
+            if (current.filled()) {
+                node(children[index]).fill(current.fillValue());
+            }
         }
+        current.setLeftChild(children[0]);
+        current.setRightChild(children[1]);
+        current.clearPending();
     }
 
+    // Goes down once: every node on the path gets its final size when
+    // it is attached to the left or to the right resulting tree.
     TreesPair split(Tree tree, size_t index) const
     {
-        if (tree == EMPTY_TREE) {
-            require(index == 0, "Index is out of range");
-            return TreesPair(EMPTY_TREE, EMPTY_TREE);
-        }
-        if (SIZE(tree->leftChild()) + 1 <= index) {
-            TreesPair splitPair = split(tree->rightChild(),
-                                        index - SIZE(tree->leftChild()) - 1);
-            tree->setRightChild(splitPair.first);
-            return TreesPair(tree, splitPair.second);
-        }
-        else {
-            TreesPair splitPair = split(tree->leftChild(), index);
-            tree->setLeftChild(splitPair.second);
-            return TreesPair(splitPair.first, tree);
+        require(index <= size(tree), "Index is out of range");
+        Tree leftTree = EMPTY_TREE;
+        Tree rightTree = EMPTY_TREE;
+        Tree* leftLink = &leftTree;
+        Tree* rightLink = &rightTree;
+        while (tree != EMPTY_TREE) {
+            tree = modifiable(tree);
+            pushDown(tree);
+            Node& current = node(tree);
+            size_t leftSize = size(current.leftChild());
+            if (leftSize + 1 <= index) {
+                current.setSize(index);
+                index -= leftSize + 1;
+                *leftLink = tree;
+                leftLink = current.rightChildLink();
+                tree = current.rightChild();
+            }
+            else {
+                current.setSize(current.size() - index);
+                *rightLink = tree;
+                rightLink = current.leftChildLink();
+                tree = current.leftChild();
+            }
         }
+        *leftLink = EMPTY_TREE;
+        *rightLink = EMPTY_TREE;
+        return TreesPair(leftTree, rightTree);
     }
 
+    // Goes down along the right spine of the left tree and the left
+    // spine of the right tree, every passed node gets size of both
+    // remaining parts.
     Tree merge(Tree leftTree, Tree rightTree) const
     {
-        if (leftTree == EMPTY_TREE) {
-            return rightTree;
-        }
-        if (rightTree == EMPTY_TREE) {
-            return leftTree;
-        }
-        if (leftTree->element().key() > rightTree->element().key()) {
-            leftTree->setRightChild(
-                        merge(leftTree->rightChild(), rightTree));
-            return leftTree;
-        }
-        else {
-            rightTree->setLeftChild(
-                        merge(leftTree, rightTree->leftChild()));
-            return rightTree;
+        Tree result = EMPTY_TREE;
+        Tree* link = &result;
+        while (leftTree != EMPTY_TREE && rightTree != EMPTY_TREE) {
+            size_t mergedSize = size(leftTree) + size(rightTree);
+            if (node(leftTree).element().key() >
+                                        node(rightTree).element().key()) {
+                leftTree = modifiable(leftTree);
+                pushDown(leftTree);
+                node(leftTree).setSize(mergedSize);
+                *link = leftTree;
+                link = node(leftTree).rightChildLink();
+                leftTree = *link;
+            }
+            else {
+                rightTree = modifiable(rightTree);
+                pushDown(rightTree);
+                node(rightTree).setSize(mergedSize);
+                *link = rightTree;
+                link = node(rightTree).leftChildLink();
+                rightTree = *link;
+            }
         }
+        *link = leftTree != EMPTY_TREE ? leftTree : rightTree;
+        return result;
     }
 
-    void build()
+    // Builds tree from elements given in order of positions in linear
+    // time, keeping the right spine of the tree in a stack.
+    void build(const std::vector<Element>& elements)
     {
-        // TODO: add linear time build from collection
-        throw std::runtime_error("Unsupported operation");
+        std::vector<Tree> rightSpine;
+        for (size_t index = 0; index < elements.size(); ++index) {
+            Tree tree = pool_->create(Node(elements[index]));
+            Tree lastPopped = EMPTY_TREE;
+            while (!rightSpine.empty() &&
+                   node(rightSpine.back()).element().key() <=
+                                                elements[index].key()) {
+                lastPopped = rightSpine.back();
+                rightSpine.pop_back();
+                updateSize(lastPopped);
+            }
+            node(tree).setLeftChild(lastPopped);
+            if (!rightSpine.empty()) {
+                node(rightSpine.back()).setRightChild(tree);
+            }
+            rightSpine.push_back(tree);
+        }
+        while (!rightSpine.empty()) {
+            root_ = rightSpine.back();
+            rightSpine.pop_back();
+            updateSize(root_);
+        }
     }
 
-    std::auto_ptr<Node> root_;
+    Pool* pool_;
+    Tree root_;
+    bool persistent_;
 };
 
 
+template <class T>
+void write(std::ostream& os, const std::vector<T>& values)
+{
+    for (size_t i = 0; i < values.size(); ++i) {
+        os << values[i];
+    }
+}
+
+inline void write(std::ostream& os, const std::vector<char>& values)
+{
+    os.write(values.data(), values.size());
+}
+
+// Drops rotations by zero and sums shifts of consecutive rotations
+// of the same segment.
+template <class Rotation>
+std::vector<Rotation> coalesceRotations(const std::vector<Rotation>& rotations)
+{
+    std::vector<Rotation> result;
+    for (size_t index = 0; index < rotations.size(); ++index) {
+        Rotation rotation = rotations[index];
+        require(rotation.start <= rotation.end,
+                "Incorrect elements subsegment for rotate operation");
+        size_t length = rotation.end - rotation.start;
+        if (length <= 1) {
+            continue;
+        }
+        rotation.shift %= length;
+        if (!result.empty() && result.back().start == rotation.start &&
+                               result.back().end == rotation.end) {
+            result.back().shift =
+                        (result.back().shift + rotation.shift) % length;
+            if (result.back().shift == 0) {
+                result.pop_back();
+            }
+        }
+        else if (rotation.shift != 0) {
+            result.push_back(rotation);
+        }
+    }
+    return result;
+}
+
 template <class T>
 class Vector
 {
@@ -283,28 +589,66 @@ public:
     typedef Element<int, T> ElementType;
     typedef CartesianTree<ElementType> Tree;
 
-    Vector() { }
+    // In persistent mode every change keeps the previous versions
+    // readable, copying only O(log n) nodes it passes.
+    explicit Vector(bool persistent = false)
+        : tree_(&pool_, EMPTY_TREE, persistent), persistent_(persistent)
+    {
+        commit();
+    }
 
     void append(T value)
     {
         ElementType element(random(), value);
         tree_.append(element);
+        commit();
+    }
+
+    // Appends sequence in linear time.
+    void append(const T* begin, const T* end)
+    {
+        tree_.merge(Tree(&pool_, elements(begin, end)));
+        commit();
     }
 
     T at(size_t index) const
     {
-        return tree_.find(index)->element().value();
+        return tree_.find(index).value();
+    }
+
+    // Version 0 is the empty vector, every change adds a version in
+    // persistent mode.
+    size_t numVersions() const { return versions_.size(); }
+
+    T at(size_t version, size_t index) const
+    {
+        return versions_.at(version).find(index).value();
     }
 
     void put(size_t index, T value)
     {
-        // TODO: implement replace element operation
-        throw std::runtime_error("Unsupported operation exception");
+        tree_.replace(index, ElementType(tree_.find(index).key(), value));
+        commit();
     }
 
-    void append(Type other)
+    // Replaces elements of [begin, end) by values in linear time. Nodes
+    // of the segment are overwritten, in persistent mode a new subtree
+    // is built instead, so older versions keep their values.
+    void assign(size_t begin, size_t end, const T* values)
     {
-        tree_.merge(other.release());
+        require(begin <= end && end <= size(),
+                "Incorrect elements subsegment for assign operation");
+        Tree middle = tree_.split(begin);
+        Tree tail = middle.split(end - begin);
+        if (persistent_) {
+            tree_.merge(Tree(&pool_, elements(values, values + end - begin)));
+        }
+        else {
+            middle.setValues(values);
+            tree_.merge(middle);
+        }
+        tree_.merge(tail);
+        commit();
     }
 
     void rotate(size_t begin, size_t end, size_t shift)
@@ -312,36 +656,506 @@ public:
         require(begin <= end,
                 "Incorrect elements subsegment for rotate operation");
         if (begin + 1 < end) {
-            shift %= end - begin;
-            Tree middle = tree_.split(begin);
-            Tree tail = middle.split(end - begin);
-            Tree middlePart = middle.split(shift);
-            middlePart.merge(middle);
-            tree_.merge(middlePart);
-            tree_.merge(tail);
+            rotate(&tree_, begin, end, shift % (end - begin));
+        }
+        commit();
+    }
+
+    // Reverses order of elements of [begin, end) in O(log n).
+    void reverse(size_t begin, size_t end)
+    {
+        require(begin <= end && end <= size(),
+                "Incorrect elements subsegment for reverse operation");
+        Tree middle = tree_.split(begin);
+        Tree tail = middle.split(end - begin);
+        middle.reverse();
+        tree_.merge(middle);
+        tree_.merge(tail);
+        commit();
+    }
+
+    // Sets all elements of [begin, end) to value in O(log n).
+    void fill(size_t begin, size_t end, T value)
+    {
+        require(begin <= end && end <= size(),
+                "Incorrect elements subsegment for fill operation");
+        Tree middle = tree_.split(begin);
+        Tree tail = middle.split(end - begin);
+        middle.fill(value);
+        tree_.merge(middle);
+        tree_.merge(tail);
+        commit();
+    }
+
+    // Applies rotations (with start, end and shift fields) in order.
+    // Rotations of the same segment in a row are coalesced. A run of
+    // rotations inside a short window is applied to the window split
+    // out once, so their splits and merges descend a small tree.
+    template <class Rotation>
+    void rotate(const std::vector<Rotation>& rotations)
+    {
+        if (persistent_) {
+            for (size_t index = 0; index < rotations.size(); ++index) {
+                const Rotation& rotation = rotations[index];
+                rotate(rotation.start, rotation.end, rotation.shift);
+            }
+            return;
+        }
+        std::vector<Rotation> coalesced = coalesceRotations(rotations);
+        size_t index = 0;
+        while (index < coalesced.size()) {
+            size_t windowBegin = coalesced[index].start;
+            size_t windowEnd = coalesced[index].end;
+            size_t last = index + 1;
+            while (last < coalesced.size()) {
+                size_t begin = std::min(windowBegin, coalesced[last].start);
+                size_t end = std::max(windowEnd, coalesced[last].end);
+                if ((end - begin) * WINDOW_RATIO > size()) {
+                    break;
+                }
+                windowBegin = begin;
+                windowEnd = end;
+                ++last;
+            }
+            if (last == index + 1) {
+                const Rotation& rotation = coalesced[index];
+                rotate(&tree_, rotation.start, rotation.end, rotation.shift);
+            }
+            else {
+                Tree window = tree_.split(windowBegin);
+                Tree tail = window.split(windowEnd - windowBegin);
+                for (size_t i = index; i < last; ++i) {
+                    const Rotation& rotation = coalesced[i];
+                    rotate(&window, rotation.start - windowBegin,
+                           rotation.end - windowBegin, rotation.shift);
+                }
+                tree_.merge(window);
+                tree_.merge(tail);
+            }
+            index = last;
         }
     }
 
     size_t size() const { return tree_.size(); }
 
+    // Copies elements to output in order.
+    void copyTo(T* output) const
+    {
+        copyTo(tree_, output);
+    }
+
+    void copyTo(size_t version, T* output) const
+    {
+        copyTo(versions_.at(version), output);
+    }
+
     friend std::ostream& operator<<(std::ostream& os, const Type& vector)
     {
-        for (size_t i = 0; i < vector.size(); ++i) {
-            os << vector.at(i);
-        }
+        std::vector<T> buffer(vector.size());
+        vector.copyTo(buffer.data());
+        write(os, buffer);
         return os;
     }
 
 private:
     // no copyable
-    explicit Vector(const Type& other) { }
+    explicit Vector(const Type& other);
+
+    // window of batch rotations is at most 1 / WINDOW_RATIO of vector
+    static const size_t WINDOW_RATIO = 8;
+
+    std::vector<ElementType> elements(const T* begin, const T* end) const
+    {
+        std::vector<ElementType> result;
+        result.reserve(end - begin);
+        for (const T* value = begin; value != end; ++value) {
+            result.push_back(ElementType(random(), *value));
+        }
+        return result;
+    }
+
+    void commit()
+    {
+        if (persistent_) {
+            versions_.push_back(tree_);
+        }
+    }
+
+    static void copyTo(const Tree& tree, T* output)
+    {
+        tree.forEach([&output](const ElementType& element) {
+            *output++ = element.value();
+        });
+    }
+
+    static void rotate(Tree* tree, size_t begin, size_t end, size_t shift)
+    {
+        Tree middle = tree->split(begin);
+        Tree tail = middle.split(end - begin);
+        Tree middlePart = middle.split(shift);
+        middlePart.merge(middle);
+        tree->merge(middlePart);
+        tree->merge(tail);
+    }
 
     int random() const
     {
         return (rand() << 16) + rand();
     }
 
+    typename Tree::Pool pool_;
     Tree tree_;
+    bool persistent_;
+    std::vector<Tree> versions_;
+};
+
+// Treap node keeping a chunk of up to CAPACITY consecutive elements,
+// for chars the node fills a cache line.
+template <class T>
+class ChunkNode
+{
+public:
+    typedef NodeIndex Index;
+
+    static const size_t MAX_SIZE = std::numeric_limits<uint32_t>::max();
+    static const size_t HEADER_SIZE = 4 * sizeof(uint32_t) + 1;
+    static const size_t CAPACITY = sizeof(T) + HEADER_SIZE < 64 ?
+                                   (64 - HEADER_SIZE) / sizeof(T) : 1;
+
+    // constructs node of the empty tree
+    ChunkNode()
+        : key_(0), leftChild_(EMPTY_TREE), rightChild_(EMPTY_TREE),
+        size_(0), count_(0) { }
+
+    ChunkNode(int key, const T* begin, const T* end)
+        : key_(key), leftChild_(EMPTY_TREE), rightChild_(EMPTY_TREE),
+        size_(end - begin), count_(end - begin)
+    {
+        std::copy(begin, end, data_);
+    }
+
+    int key() const { return key_; }
+
+    void setLeftChild(Index node) { leftChild_ = node; }
+
+    Index leftChild() const { return leftChild_; }
+
+    void setRightChild(Index node) { rightChild_ = node; }
+
+    Index rightChild() const { return rightChild_; }
+
+    Index* leftChildLink() { return &leftChild_; }
+
+    Index* rightChildLink() { return &rightChild_; }
+
+    size_t size() const { return size_; }
+
+    void setSize(size_t size) { size_ = size; }
+
+    // number of elements in the chunk of the node
+    size_t count() const { return count_; }
+
+    const T* begin() const { return data_; }
+
+    const T* end() const { return data_ + count_; }
+
+    void truncate(size_t count) { count_ = count; }
+
+    void append(const T* begin, const T* end)
+    {
+        std::copy(begin, end, data_ + count_);
+        count_ += end - begin;
+    }
+
+private:
+    int key_;
+    Index leftChild_;
+    Index rightChild_;
+    uint32_t size_;
+    uint8_t count_;
+    T data_[CAPACITY];
+};
+
+// Sequence kept as a treap of chunks (unrolled rope). It takes about
+// an order of magnitude less memory per element than Vector and is
+// copied out chunk by chunk. Splits cut inside chunks, merges fuse
+// adjacent chunks which fit into one, so chunks do not get fragmented.
+template <class T>
+class ChunkedVector
+{
+public:
+    typedef ChunkedVector<T> Type;
+    typedef ChunkNode<T> Node;
+    typedef NodePool<Node> Pool;
+    typedef typename Pool::Index Tree;
+
+    static const size_t CAPACITY = Node::CAPACITY;
+
+    ChunkedVector() : root_(EMPTY_TREE) { }
+
+    void append(T value)
+    {
+        append(&value, &value + 1);
+    }
+
+    // Appends sequence in linear time.
+    void append(const T* begin, const T* end)
+    {
+        root_ = join(root_, build(begin, end));
+    }
+
+    T at(size_t index) const
+    {
+        require(index < size(), "Index is out of range");
+        Tree tree = root_;
+        while (true) {
+            const Node& current = node(tree);
+            size_t leftSize = size(current.leftChild());
+            if (index < leftSize) {
+                tree = current.leftChild();
+            }
+            else if (index < leftSize + current.count()) {
+                return current.begin()[index - leftSize];
+            }
+            else {
+                index -= leftSize + current.count();
+                tree = current.rightChild();
+            }
+        }
+    }
+
+    void rotate(size_t begin, size_t end, size_t shift)
+    {
+        require(begin <= end && end <= size(),
+                "Incorrect elements subsegment for rotate operation");
+        if (begin + 1 >= end || shift % (end - begin) == 0) {
+            return;
+        }
+        shift %= end - begin;
+        std::pair<Tree, Tree> head = split(root_, begin);
+        std::pair<Tree, Tree> middle = split(head.second, end - begin);
+        std::pair<Tree, Tree> parts = split(middle.first, shift);
+        root_ = join(join(head.first, join(parts.second, parts.first)),
+                     middle.second);
+        compactIfSparse();
+    }
+
+    // Applies rotations (with start, end and shift fields) in order.
+    template <class Rotation>
+    void rotate(const std::vector<Rotation>& rotations)
+    {
+        std::vector<Rotation> coalesced = coalesceRotations(rotations);
+        for (size_t index = 0; index < coalesced.size(); ++index) {
+            const Rotation& rotation = coalesced[index];
+            rotate(rotation.start, rotation.end, rotation.shift);
+        }
+    }
+
+    size_t size() const { return size(root_); }
+
+    size_t numChunks() const { return pool_.numNodes(); }
+
+    // Copies elements to output in order.
+    void copyTo(T* output) const
+    {
+        std::vector<Tree> path;
+        Tree tree = root_;
+        while (tree != EMPTY_TREE || !path.empty()) {
+            if (tree != EMPTY_TREE) {
+                path.push_back(tree);
+                tree = node(tree).leftChild();
+                continue;
+            }
+            const Node& current = node(path.back());
+            path.pop_back();
+            output = std::copy(current.begin(), current.end(), output);
+            tree = current.rightChild();
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Type& vector)
+    {
+        std::vector<T> buffer(vector.size());
+        vector.copyTo(buffer.data());
+        write(os, buffer);
+        return os;
+    }
+
+private:
+    // no copyable
+    explicit ChunkedVector(const Type& other);
+
+    // chunks are rebuilt full when there are a third more of them than
+    // needed, so they are filled by three quarters on average
+    static const size_t COMPACTION_NUMERATOR = 4;
+    static const size_t COMPACTION_DENOMINATOR = 3;
+
+    Node& node(Tree tree) const { return const_cast<Pool&>(pool_)[tree]; }
+
+    size_t size(Tree tree) const { return pool_.size(tree); }
+
+    void updateSize(Tree tree) const
+    {
+        Node& current = node(tree);
+        current.setSize(size(current.leftChild()) +
+                        size(current.rightChild()) + current.count());
+    }
+
+    // Cuts of splits leave chunks which joins do not always fuse with
+    // their neighbours, so the tree is rebuilt of full chunks once they
+    // get sparse. Every rotation adds at most three chunks, so this
+    // takes O(CAPACITY) time per rotation amortized.
+    void compactIfSparse()
+    {
+        size_t minNumChunks = size() / CAPACITY + 1;
+        if (pool_.numNodes() * COMPACTION_DENOMINATOR <=
+                                    minNumChunks * COMPACTION_NUMERATOR) {
+            return;
+        }
+        std::vector<T> buffer(size());
+        copyTo(buffer.data());
+        pool_.clear();
+        root_ = build(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    // Builds tree of full chunks in linear time, as CartesianTree does.
+    Tree build(const T* begin, const T* end)
+    {
+        std::vector<Tree> rightBranch;
+        for (const T* chunk = begin; chunk != end; ) {
+            size_t count = end - chunk;
+            if (count > CAPACITY) {
+                count = CAPACITY;
+            }
+            const T* chunkEnd = chunk + count;
+            Tree tree = pool_.create(Node(random(), chunk, chunkEnd));
+            chunk = chunkEnd;
+            Tree lastPopped = EMPTY_TREE;
+            while (!rightBranch.empty() &&
+                   node(rightBranch.back()).key() < node(tree).key()) {
+                lastPopped = rightBranch.back();
+                rightBranch.pop_back();
+                updateSize(lastPopped);
+            }
+            node(tree).setLeftChild(lastPopped);
+            if (!rightBranch.empty()) {
+                node(rightBranch.back()).setRightChild(tree);
+            }
+            rightBranch.push_back(tree);
+        }
+        while (rightBranch.size() > 1) {
+            updateSize(rightBranch.back());
+            rightBranch.pop_back();
+        }
+        if (rightBranch.empty()) {
+            return EMPTY_TREE;
+        }
+        updateSize(rightBranch.back());
+        return rightBranch.back();
+    }
+
+    // Splits tree into first index elements and the rest. The chunk
+    // containing the border is cut: its tail becomes a new node merged
+    // in front of the right part. The tail takes the key of the cut
+    // node, so it stays below the node owning rightLink.
+    std::pair<Tree, Tree> split(Tree tree, size_t index)
+    {
+        std::pair<Tree, Tree> result(EMPTY_TREE, EMPTY_TREE);
+        Tree* leftLink = &result.first;
+        Tree* rightLink = &result.second;
+        while (tree != EMPTY_TREE) {
+            Node& current = node(tree);
+            size_t leftSize = size(current.leftChild());
+            if (index <= leftSize) {
+                current.setSize(current.size() - index);
+                *rightLink = tree;
+                rightLink = current.leftChildLink();
+                tree = current.leftChild();
+            }
+            else if (index >= leftSize + current.count()) {
+                current.setSize(index);
+                index -= leftSize + current.count();
+                *leftLink = tree;
+                leftLink = current.rightChildLink();
+                tree = current.rightChild();
+            }
+            else {
+                size_t offset = index - leftSize;
+                Tree tail = pool_.create(Node(current.key(),
+                                current.begin() + offset, current.end()));
+                *rightLink = merge(tail, current.rightChild());
+                current.truncate(offset);
+                current.setRightChild(EMPTY_TREE);
+                current.setSize(index);
+                *leftLink = tree;
+                return result;
+            }
+        }
+        *leftLink = EMPTY_TREE;
+        *rightLink = EMPTY_TREE;
+        return result;
+    }
+
+    Tree merge(Tree left, Tree right)
+    {
+        Tree result = EMPTY_TREE;
+        Tree* link = &result;
+        while (left != EMPTY_TREE && right != EMPTY_TREE) {
+            Node& leftNode = node(left);
+            Node& rightNode = node(right);
+            if (leftNode.key() > rightNode.key()) {
+                leftNode.setSize(leftNode.size() + rightNode.size());
+                *link = left;
+                link = leftNode.rightChildLink();
+                left = leftNode.rightChild();
+            }
+            else {
+                rightNode.setSize(rightNode.size() + leftNode.size());
+                *link = right;
+                link = rightNode.leftChildLink();
+                right = rightNode.leftChild();
+            }
+        }
+        *link = left != EMPTY_TREE ? left : right;
+        return result;
+    }
+
+    // Merges trees, moving the first chunk of right into the last chunk
+    // of left when they fit into one.
+    Tree join(Tree left, Tree right)
+    {
+        if (left == EMPTY_TREE || right == EMPTY_TREE) {
+            return merge(left, right);
+        }
+        Tree first = right;
+        while (node(first).leftChild() != EMPTY_TREE) {
+            first = node(first).leftChild();
+        }
+        size_t count = node(first).count();
+        Tree last = left;
+        while (node(last).rightChild() != EMPTY_TREE) {
+            last = node(last).rightChild();
+        }
+        if (node(last).count() + count > CAPACITY) {
+            return merge(left, right);
+        }
+        node(last).append(node(first).begin(), node(first).end());
+        for (Tree tree = left; tree != EMPTY_TREE;
+             tree = node(tree).rightChild()) {
+            node(tree).setSize(node(tree).size() + count);
+        }
+        std::pair<Tree, Tree> rest = split(right, count);
+        pool_.destroy(rest.first);
+        return merge(left, rest.second);
+    }
+
+    int random() const
+    {
+        return (rand() << 16) + rand();
+    }
+
+    Pool pool_;
+    Tree root_;
 };
 
 struct Query
@@ -351,13 +1165,12 @@ struct Query
     size_t shift;
 };
 
-void readData(std::vector<Query>* queries, Vector<char>* sequence)
+template <class Sequence>
+void readData(std::vector<Query>* queries, Sequence* sequence)
 {
     std::string message;
     std::cin >> message;
-    for (size_t i = 0; i < message.size(); ++i) {
-        sequence->append(message[i]);
-    }
+    sequence->append(message.data(), message.data() + message.size());
 
     size_t numQueries;
     std::cin >> numQueries;
@@ -375,25 +1188,106 @@ void readData(std::vector<Query>* queries, Vector<char>* sequence)
     std::reverse(queries->begin(), queries->end());
 }
 
-void decodeSequence(const std::vector<Query>& queries, Vector<char>* sequence)
+template <class Sequence>
+void decodeSequence(const std::vector<Query>& queries, Sequence* sequence)
+{
+    sequence->rotate(queries);
+}
+
+#ifdef BENCHMARK
+// Segments of length up to maxLength inside a window of windowSize
+// moved every 100 queries, with runs of repeated segments.
+void generateQueries(size_t size, size_t windowSize, size_t maxLength,
+                     size_t numQueries, std::vector<Query>* queries)
+{
+    queries->clear();
+    size_t windowBegin = 0;
+    for (size_t index = 0; index < numQueries; ++index) {
+        if (index % 100 == 0) {
+            windowBegin = rand() % (size - windowSize + 1);
+        }
+        Query query;
+        if (index > 0 && rand() % 4 == 0) {
+            query = queries->back();
+        }
+        else {
+            size_t length = rand() % std::min(maxLength, windowSize) + 1;
+            query.start = windowBegin + rand() % (windowSize - length + 1);
+            query.end = query.start + length;
+        }
+        query.shift = rand();
+        queries->push_back(query);
+    }
+}
+
+template <class Sequence>
+double measure(const std::string& message, const std::vector<Query>& queries,
+               bool batch, std::string* result)
+{
+    srand(1);
+    Sequence sequence;
+    sequence.append(message.data(), message.data() + message.size());
+    clock_t start = clock();
+    if (batch) {
+        sequence.rotate(queries);
+    }
+    else {
+        for (size_t index = 0; index < queries.size(); ++index) {
+            const Query& query = queries[index];
+            sequence.rotate(query.start, query.end, query.shift);
+        }
+    }
+    double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+    result->resize(sequence.size());
+    sequence.copyTo(&(*result)[0]);
+    return queries.size() / seconds;
+}
+
+void benchmark(const std::string& name, size_t windowSize, size_t maxLength)
 {
-    for (size_t queryIndex = 0; queryIndex < queries.size(); ++queryIndex) {
-        const Query query = queries[queryIndex];
-        sequence->rotate(query.start, query.end, query.shift);
+    static const size_t SIZE = 1000000;
+    static const size_t NUM_QUERIES = 1000000;
+    std::string message(SIZE, 'a');
+    for (size_t index = 0; index < SIZE; ++index) {
+        message[index] += rand() % 26;
     }
+    std::vector<Query> queries;
+    generateQueries(SIZE, windowSize, maxLength, NUM_QUERIES, &queries);
+    std::string perQueryResult;
+    std::string batchResult;
+    std::string chunkedResult;
+    double perQuery = measure<Vector<char> >(message, queries, false,
+                                             &perQueryResult);
+    double batch = measure<Vector<char> >(message, queries, true,
+                                          &batchResult);
+    double chunked = measure<ChunkedVector<char> >(message, queries, true,
+                                                   &chunkedResult);
+    require(perQueryResult == batchResult, "Batch result differs");
+    require(perQueryResult == chunkedResult, "Chunked result differs");
+    std::cout << name << ": per query " << static_cast<size_t>(perQuery)
+              << " ops/s, batch " << static_cast<size_t>(batch)
+              << " ops/s, chunked " << static_cast<size_t>(chunked)
+              << " ops/s" << std::endl;
 }
+#endif
 
 int main()
 {
     std::ios_base::sync_with_stdio(false);
 
+#ifdef BENCHMARK
+    benchmark("uniform", 1000000, 1000000);
+    benchmark("local", 10000, 1000);
+    benchmark("short", 1000000, 100);
+#else
     std::vector<Query> queries;
-    Vector<char> sequence;
+    ChunkedVector<char> sequence;
     readData(&queries, &sequence);
 
     decodeSequence(queries, &sequence);
 
     std::cout << sequence << std::endl;
+#endif
 
     return 0;
 }
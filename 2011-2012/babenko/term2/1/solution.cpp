@@ -1,11 +1,26 @@
 #include <limits>
 #include <set>
 #include <queue>
+#include <functional>
 #include <iostream>
 #include <vector>
 #include <cassert>
 #include <algorithm>
 #include <utility>
+#include <string>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <cmath>
+#endif
 
 #define NDEBUG
 
@@ -20,28 +35,37 @@ typedef std::vector<Id> Ids;
 
 const Id UNDEFINED = std::numeric_limits<Id>::max();
 
+// Edges and arcs are packed into 32-bit fields, so a graph may have
+// up to 2^32 vertices and edges. Edges are stored in binary edge list
+// files as they are in memory.
 struct Edge
 {
-    Id first;
-    Id second;
-    size_t weight;
-    Id id;
+    Edge() { }
+    Edge(Id firstIn, Id secondIn, size_t weightIn, Id idIn)
+        : first(firstIn), second(secondIn), weight(weightIn), id(idIn) { }
+    uint32_t first;
+    uint32_t second;
+    uint32_t weight;
+    uint32_t id;
 };
 
 struct Arc
 {
     Arc() : to(-1), id(-1) { }
     Arc(Id toIn, Id idIn) : to(toIn), id(idIn) { }
-    Id to;
-    Id id;
+    uint32_t to;
+    uint32_t id;
 };
 
 typedef std::vector<Edge> Edges;
 
+// Union-find linking smaller groups under larger ones, so trees stay
+// of logarithmic depth, and finds are iterative: the root is found
+// first, then the path is compressed by the second pass.
 class DisjointSet
 {
 public:
-    explicit DisjointSet(size_t size) : groupIds_(size)
+    explicit DisjointSet(size_t size) : groupIds_(size), sizes_(size, 1)
     {
         for (size_t index = 0; index < groupIds_.size(); ++index) {
             groupIds_[index] = index;
@@ -52,18 +76,24 @@ public:
         first = groupId(first);
         second = groupId(second);
         REQUIRE(first != second, "Cannot merge same groups.");
-        if (rand() & 1) {
-            groupIds_[first] = second;
-        } else {
-            groupIds_[second] = first;
+        if (sizes_[first] < sizes_[second]) {
+            std::swap(first, second);
         }
+        groupIds_[second] = first;
+        sizes_[first] += sizes_[second];
     }
     Id groupId(Id one)
     {
-        if (groupIds_[one] != one) {
-            groupIds_[one] = groupId(groupIds_[one]);
+        Id root = one;
+        while (groupIds_[root] != root) {
+            root = groupIds_[root];
+        }
+        while (groupIds_[one] != root) {
+            Id parent = groupIds_[one];
+            groupIds_[one] = root;
+            one = parent;
         }
-        return groupIds_[one];
+        return root;
     }
     bool hasOneGroup()
     {
@@ -79,28 +109,145 @@ public:
     }
 private:
     Ids groupIds_;
+    Ids sizes_;
 };
 
+// Union-find safe for concurrent merges: a root is linked under
+// a root with smaller id by compare-and-swap, so links never form
+// a cycle, and finds halve paths as they go.
+class ConcurrentDisjointSet
+{
+public:
+    explicit ConcurrentDisjointSet(size_t size) : groupIds_(size)
+    {
+        #pragma omp parallel for
+        for (size_t index = 0; index < groupIds_.size(); ++index) {
+            groupIds_[index].store(index, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false if elements are already in the same group.
+    bool merge(Id first, Id second)
+    {
+        while (true) {
+            first = groupId(first);
+            second = groupId(second);
+            if (first == second) {
+                return false;
+            }
+            if (first < second) {
+                std::swap(first, second);
+            }
+            uint32_t root = first;
+            if (groupIds_[first].compare_exchange_strong(root, second)) {
+                return true;
+            }
+        }
+    }
+
+    Id groupId(Id one)
+    {
+        while (true) {
+            uint32_t parent = groupIds_[one].load();
+            if (parent == one) {
+                return one;
+            }
+            uint32_t grandParent = groupIds_[parent].load();
+            if (parent != grandParent) {
+                groupIds_[one].compare_exchange_weak(parent, grandParent);
+            }
+            one = grandParent;
+        }
+    }
+
+    bool hasOneGroup()
+    {
+        REQUIRE(!groupIds_.empty(), "Disjoint set is empty,"
+                << "cannot determine if there is only one group");
+        Id element = groupId(0);
+        bool result = true;
+        #pragma omp parallel for reduction(&&:result)
+        for (size_t index = 0; index < groupIds_.size(); ++index) {
+            result = result && groupId(index) == element;
+        }
+        return result;
+    }
+
+private:
+    std::vector<std::atomic<uint32_t> > groupIds_;
+};
+
+// Sequence of values stored contiguously, which the range does
+// not own.
+template <class T>
+class Range
+{
+public:
+    Range(const T* begin, const T* end) : begin_(begin), end_(end)
+    {
+    }
+
+    Range(const std::vector<T>& values)
+        : begin_(values.data()), end_(values.data() + values.size())
+    {
+    }
+
+    size_t size() const
+    {
+        return end_ - begin_;
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return begin_[index];
+    }
+
+    const T* begin() const
+    {
+        return begin_;
+    }
+
+    const T* end() const
+    {
+        return end_;
+    }
+
+private:
+    const T* begin_;
+    const T* end_;
+};
+
+typedef Range<Arc> ArcsRange;
+typedef Range<Edge> EdgesRange;
+
+// Graph in compressed sparse row form: arcs incident to a vertex
+// occupy [offsets_[vertex], offsets_[vertex + 1]) of the flat arcs_
+// array. Graph refers to edges, they should outlive it.
 class Graph
 {
 public:
     typedef std::vector<Arc> Arcs;
-    typedef Arcs IncidentArcs;
+    typedef ArcsRange IncidentArcs;
 
-    Graph(size_t numVertices, const Edges& edges)
+    Graph(size_t numVertices, EdgesRange edges)
         : numVertices_(numVertices), edges_(edges)
     {
         buildGraph();
     }
 
-    const IncidentArcs& incidentArcs(Id vertex) const
+    IncidentArcs incidentArcs(Id vertex) const
     {
-        return graph_.at(vertex);
+        REQUIRE(vertex < numVertices_, "Vertex is out of range");
+        const Arc* arcs = arcs_.data();
+        return IncidentArcs(arcs + offsets_[vertex],
+                            arcs + offsets_[vertex + 1]);
     }
 
     const Arc& arc(Id vertex, size_t index) const
     {
-        return incidentArcs(vertex).at(index);
+        REQUIRE(index < incidentArcs(vertex).size(),
+                "Arc index is out of range");
+        return arcs_[offsets_[vertex] + index];
     }
 
     size_t numVertices() const
@@ -113,55 +260,73 @@ public:
         return edges_.size();
     }
 
-    const Edges& edges() const
+    EdgesRange edges() const
     {
         return edges_;
     }
 
-    // Returns spanning tree edges as the first element of
-    // the resulting pair, and returns other edges as the second
-    // element.
-    std::pair<Edges, Edges> spanningTree() const
+    // Marks edges of a spanning tree by their ids.
+    void spanningTree(std::vector<char>* isTreeEdge) const
     {
-        Edges spanningEdges;
-        Edges others;
+        isTreeEdge->assign(edges_.size(), false);
         DisjointSet dset(numVertices());
         for (size_t edgeId = 0; edgeId < edges_.size(); ++edgeId) {
             const Edge& edge = edges_[edgeId];
             if (dset.groupId(edge.first) != dset.groupId(edge.second)) {
-                spanningEdges.push_back(edge);
+                (*isTreeEdge)[edge.id] = true;
                 dset.merge(edge.first, edge.second);
             }
-            else {
-                others.push_back(edge);
+        }
+        REQUIRE(dset.hasOneGroup(),
+                "Spanning edges do not form connected graph.");
+    }
+
+    // The same for concurrent use, the spanning tree may differ from
+    // the one built sequentially.
+    void parallelSpanningTree(std::vector<char>* isTreeEdge) const
+    {
+        isTreeEdge->assign(edges_.size(), false);
+        ConcurrentDisjointSet dset(numVertices());
+        #pragma omp parallel for schedule(dynamic, 4096)
+        for (size_t edgeId = 0; edgeId < edges_.size(); ++edgeId) {
+            const Edge& edge = edges_[edgeId];
+            if (dset.merge(edge.first, edge.second)) {
+                (*isTreeEdge)[edge.id] = true;
             }
         }
         REQUIRE(dset.hasOneGroup(),
                 "Spanning edges do not form connected graph.");
-        return std::make_pair(spanningEdges, others);
     }
 
 private:
+    // Counts degrees first, then places arcs in order of edges.
     void buildGraph()
     {
-        graph_.resize(numVertices_);
+        REQUIRE(numVertices_ <= std::numeric_limits<uint32_t>::max() &&
+                edges_.size() <= std::numeric_limits<uint32_t>::max(),
+                "Graph is too large for 32-bit arcs");
+        offsets_.assign(numVertices_ + 1, 0);
         for (size_t index = 0; index < edges_.size(); ++index) {
-            addDirectedEdge(edges_[index].first,
-                            edges_[index].second, edges_[index].id);
-            addDirectedEdge(edges_[index].second,
-                            edges_[index].first, edges_[index].id);
+            ++offsets_[edges_[index].first + 1];
+            ++offsets_[edges_[index].second + 1];
+        }
+        for (size_t vertex = 0; vertex < numVertices_; ++vertex) {
+            offsets_[vertex + 1] += offsets_[vertex];
+        }
+        arcs_.resize(offsets_[numVertices_]);
+        std::vector<size_t> positions(offsets_.begin(), offsets_.end() - 1);
+        for (size_t index = 0; index < edges_.size(); ++index) {
+            const Edge& edge = edges_[index];
+            arcs_[positions[edge.first]++] = Arc(edge.second, edge.id);
+            arcs_[positions[edge.second]++] = Arc(edge.first, edge.id);
         }
-    }
-
-    void addDirectedEdge(size_t from, size_t to, size_t id)
-    {
-        graph_.at(from).push_back(Arc(to, id));
     }
 
 private:
     size_t numVertices_;
-    const Edges edges_;
-    std::vector<IncidentArcs> graph_;
+    EdgesRange edges_;
+    std::vector<size_t> offsets_;
+    Arcs arcs_;
 };
 
 void readData(size_t& numVertices, Edges* edges)
@@ -178,23 +343,228 @@ void readData(size_t& numVertices, Edges* edges)
     }
 }
 
-Edges to0Notation(Edges edges)
+void to0Notation(Edges* edges)
 {
-    for (Id index = 0; index < edges.size(); ++index) {
-        --edges[index].first;
-        --edges[index].second;
+    for (Id index = 0; index < edges->size(); ++index) {
+        --(*edges)[index].first;
+        --(*edges)[index].second;
     }
-    return edges;
 }
 
-class ProbableEdgesCutSolver
+// Binary edge list is the header followed by numEdges edges with
+// vertices numbered from 0 and ids equal to their positions.
+struct EdgeListHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t numVertices;
+    uint64_t numEdges;
+};
+
+const char EDGE_LIST_MAGIC[4] = {'E', 'D', 'G', 'L'};
+const uint32_t EDGE_LIST_VERSION = 1;
+
+void writeBinaryEdges(FILE* file, size_t numVertices, EdgesRange edges)
+{
+    EdgeListHeader header;
+    memcpy(header.magic, EDGE_LIST_MAGIC, sizeof(header.magic));
+    header.version = EDGE_LIST_VERSION;
+    header.numVertices = numVertices;
+    header.numEdges = edges.size();
+    REQUIRE(fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(edges.begin(), sizeof(Edge), edges.size(), file) ==
+            edges.size(), "Cannot write edge list");
+}
+
+// Binary edge list mapped into memory, its edges are used in place.
+class MappedEdgeList
 {
 public:
-    explicit ProbableEdgesCutSolver(const Graph& graph, size_t numBits = 60)
+    explicit MappedEdgeList(int file) : data_(MAP_FAILED), size_(0)
+    {
+        struct stat info;
+        REQUIRE(fstat(file, &info) == 0 && S_ISREG(info.st_mode),
+                "Edge list should be a regular file");
+        size_ = info.st_size;
+        REQUIRE(size_ >= sizeof(EdgeListHeader), "Edge list is truncated");
+        data_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, file, 0);
+        REQUIRE(data_ != MAP_FAILED, "Cannot map edge list");
+        madvise(data_, size_, MADV_SEQUENTIAL);
+        const EdgeListHeader& header = this->header();
+        REQUIRE(memcmp(header.magic, EDGE_LIST_MAGIC,
+                       sizeof(header.magic)) == 0 &&
+                header.version == EDGE_LIST_VERSION,
+                "Unknown edge list format");
+        REQUIRE(size_ == sizeof(header) + header.numEdges * sizeof(Edge),
+                "Edge list is truncated");
+        validate();
+    }
+
+    ~MappedEdgeList()
+    {
+        if (data_ != MAP_FAILED) {
+            munmap(data_, size_);
+        }
+    }
+
+    size_t numVertices() const
+    {
+        return header().numVertices;
+    }
+
+    EdgesRange edges() const
+    {
+        const char* data = static_cast<const char*>(data_);
+        const Edge* begin = reinterpret_cast<const Edge*>(
+                                        data + sizeof(EdgeListHeader));
+        return EdgesRange(begin, begin + header().numEdges);
+    }
+
+private:
+    // no copyable
+    MappedEdgeList(const MappedEdgeList&);
+    void operator=(const MappedEdgeList&);
+
+    const EdgeListHeader& header() const
+    {
+        return *static_cast<const EdgeListHeader*>(data_);
+    }
+
+    void validate() const
+    {
+        EdgesRange edges = this->edges();
+        for (size_t index = 0; index < edges.size(); ++index) {
+            const Edge& edge = edges[index];
+            REQUIRE(edge.first < numVertices() &&
+                    edge.second < numVertices() && edge.id == index,
+                    "Incorrect edge " << index << " in edge list");
+        }
+    }
+
+    void* data_;
+    size_t size_;
+};
+
+// xorshift64* generator, much faster than rand() and giving
+// all 64 bits at once.
+class Random
+{
+public:
+    explicit Random(uint64_t seed = 88172645463325252ULL)
+        : state_(seed != 0 ? seed : 1)
+    {
+    }
+
+    uint64_t next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 2685821657736338717ULL;
+    }
+
+private:
+    uint64_t state_;
+};
+
+// Label of an edge keeps one bit per random binary circulation.
+// Wide label holds 256 circulations in one SIMD register, it makes
+// false cut edges much less probable at about the same cost.
+typedef uint64_t WideLabel __attribute__((vector_size(32)));
+
+template <class Label>
+struct LabelTraits;
+
+template <>
+struct LabelTraits<uint64_t>
+{
+    static const size_t NUM_BITS = 64;
+
+    static const size_t NUM_WORDS = 1;
+
+    static bool isZero(uint64_t label)
+    {
+        return label == 0;
+    }
+
+    static bool equal(uint64_t first, uint64_t second)
+    {
+        return first == second;
+    }
+
+    static uint64_t word(uint64_t label, size_t /* index */)
+    {
+        return label;
+    }
+
+    static void random(Random* generator, size_t numBits, uint64_t* label)
+    {
+        *label = generator->next() & lowBits(numBits);
+    }
+
+    static void atomicXor(uint64_t* target, uint64_t value)
+    {
+        __atomic_fetch_xor(target, value, __ATOMIC_RELAXED);
+    }
+
+    static uint64_t lowBits(size_t numBits)
+    {
+        return numBits >= 64 ? ~0ULL : (1ULL << numBits) - 1;
+    }
+};
+
+template <>
+struct LabelTraits<WideLabel>
+{
+    static const size_t NUM_WORDS = 4;
+    static const size_t NUM_BITS = 64 * NUM_WORDS;
+
+    static bool isZero(const WideLabel& label)
+    {
+        return (label[0] | label[1] | label[2] | label[3]) == 0;
+    }
+
+    static bool equal(const WideLabel& first, const WideLabel& second)
+    {
+        return isZero(first ^ second);
+    }
+
+    static uint64_t word(const WideLabel& label, size_t index)
+    {
+        return label[index];
+    }
+
+    static void atomicXor(WideLabel* target, const WideLabel& value)
+    {
+        uint64_t* words = reinterpret_cast<uint64_t*>(target);
+        for (size_t word = 0; word < NUM_WORDS; ++word) {
+            __atomic_fetch_xor(&words[word], value[word], __ATOMIC_RELAXED);
+        }
+    }
+
+    static void random(Random* generator, size_t numBits, WideLabel* label)
+    {
+        for (size_t word = 0; word < NUM_WORDS; ++word) {
+            size_t wordBits = std::min<size_t>(numBits, 64);
+            (*label)[word] = generator->next() &
+                             LabelTraits<uint64_t>::lowBits(wordBits);
+            numBits -= wordBits;
+        }
+    }
+};
+
+template <class Label>
+class BasicProbableEdgesCutSolver
+{
+public:
+    typedef LabelTraits<Label> Traits;
+
+    explicit BasicProbableEdgesCutSolver(const Graph& graph,
+                                         size_t numBits = 60)
         : graph_(graph), numBits_(numBits)
     {
-        REQUIRE(numBits <= 64, "Cannot handle more than 64 bits "
-                << "because of 64 bit type restriction");
+        REQUIRE(numBits <= Traits::NUM_BITS, "Cannot handle more than "
+                << Traits::NUM_BITS << " bits because of label type size");
     }
 
     void solve()
@@ -205,106 +575,287 @@ public:
         collectCutEdges();
     }
 
+    // The same on all cores: spanning forest is built by concurrent
+    // union-find, rooted by BFS level by level, and circulations are
+    // completed bottom-up a level at a time.
+    void solveParallel()
+    {
+        buildParallelRootedSpanningTree();
+        generateParallelUniRandPartialCirculations();
+        completeParallelBinaryCirculations();
+        collectCutEdges();
+    }
+
+    // Also finds minimal 2-edge cuts: two edges which are not bridges
+    // form a cut iff their circulation labels are equal.
+    void solveTwoEdgeCuts()
+    {
+        solve();
+        collectTwoEdgeCuts();
+    }
+
+    // Groups edges with equal nonzero labels, each pair of edges of
+    // a group is a 2-edge cut.
+    void collectTwoEdgeCuts()
+    {
+        Ids ids;
+        for (Id id = 0; id < edgesBits_.size(); ++id) {
+            if (!Traits::isZero(edgesBits_[id])) {
+                ids.push_back(id);
+            }
+        }
+        sortByLabel(&ids);
+        EdgesRange edges = graph_.edges();
+        for (size_t begin = 0; begin < ids.size(); ) {
+            size_t end = begin + 1;
+            while (end < ids.size() &&
+                   Traits::equal(edgesBits_[ids[begin]],
+                                 edgesBits_[ids[end]])) {
+                ++end;
+            }
+            if (end - begin > 1) {
+                twoEdgeCuts_.push_back(Edges());
+                for (size_t index = begin; index < end; ++index) {
+                    twoEdgeCuts_.back().push_back(edges[ids[index]]);
+                }
+            }
+            begin = end;
+        }
+    }
+
+    // LSD radix sort of edge ids by the used bits of their labels.
+    void sortByLabel(Ids* ids) const
+    {
+        static const size_t RADIX_BITS = 16;
+        static const size_t RADIX = 1 << RADIX_BITS;
+        Ids buffer(ids->size());
+        Ids counts(RADIX + 1);
+        for (size_t bit = 0; bit < numBits_; bit += RADIX_BITS) {
+            size_t word = bit / 64;
+            size_t shift = bit % 64;
+            std::fill(counts.begin(), counts.end(), 0);
+            for (size_t index = 0; index < ids->size(); ++index) {
+                ++counts[digit((*ids)[index], word, shift) + 1];
+            }
+            for (size_t digit = 0; digit < RADIX; ++digit) {
+                counts[digit + 1] += counts[digit];
+            }
+            for (size_t index = 0; index < ids->size(); ++index) {
+                Id id = (*ids)[index];
+                buffer[counts[digit(id, word, shift)]++] = id;
+            }
+            ids->swap(buffer);
+        }
+    }
+
+    size_t digit(Id id, size_t word, size_t shift) const
+    {
+        return (Traits::word(edgesBits_[id], word) >> shift) & 0xFFFF;
+    }
+
     void collectCutEdges()
     {
-        const Edges& edges = graph_.edges();
+        EdgesRange edges = graph_.edges();
         for (size_t index = 0; index < edges.size(); ++index) {
             const Edge& edge = edges[index];
-            if (edgesBits_[edge.id] == 0) {
+            if (Traits::isZero(edgesBits_[edge.id])) {
                 cutEdges_.push_back(edge);
             }
         }
     }
 
+    // Completes circulations on tree edges, all bits of a label at once.
     void completeBinaryCirculations()
     {
-        std::vector<long long> vertexDegreeParity(graph_.numVertices());
+        std::vector<Label> vertexDegreeParity(graph_.numVertices(),
+                                              Label());
+        EdgesRange edges = graph_.edges();
         for (size_t index = 0; index < nonTreeEdges_.size(); ++index) {
-            const Edge& edge = nonTreeEdges_[index];
-            for (size_t bit = 0; bit < numBits_; ++bit) {
-                if (takeBit(edgesBits_[edge.id], bit)) {
-                    xorBit(vertexDegreeParity[edge.first], bit);
-                    xorBit(vertexDegreeParity[edge.second], bit);
-                }
-            }
+            const Edge& edge = edges[nonTreeEdges_[index]];
+            vertexDegreeParity[edge.first] ^= edgesBits_[edge.id];
+            vertexDegreeParity[edge.second] ^= edgesBits_[edge.id];
         }
         for (size_t index = 0; index < orderedVertices_.size(); ++index) {
             Id vertex = orderedVertices_[index];
             if (vertex == root_) {
                 checkBinaryCirculations(vertexDegreeParity);
             } else {
-                for (size_t bit = 0; bit < numBits_; ++bit) {
-                    if (takeBit(vertexDegreeParity[vertex], bit)) {
-                        xorBit(vertexDegreeParity[vertex], bit);
-                        const Arc& arc = rootedSpanningTreeParents_[vertex];
-                        xorBit(vertexDegreeParity[arc.to], bit);
-                        xorBit(edgesBits_[arc.id], bit);
-                    }
-                }
+                Label parity = vertexDegreeParity[vertex];
+                const Arc& arc = rootedSpanningTreeParents_[vertex];
+                vertexDegreeParity[vertex] ^= parity;
+                vertexDegreeParity[arc.to] ^= parity;
+                edgesBits_[arc.id] ^= parity;
             }
         }
     }
 
     void checkBinaryCirculations(
-                            const std::vector<long long>& vertexDegreeParity)
+                            const std::vector<Label>& vertexDegreeParity)
     {
-        for (size_t bit = 0; bit < numBits_; ++bit) {
-            REQUIRE(!takeBit(vertexDegreeParity[root_], bit),
-                    "Completed circulation " << bit << " is not binary.");
+        REQUIRE(Traits::isZero(vertexDegreeParity[root_]),
+                "Completed circulations are not binary.");
+    }
+
+    void generateUniRandPartialCirculations()
+    {
+        edgesBits_.assign(graph_.numEdges(), Label());
+        for (size_t index = 0; index < nonTreeEdges_.size(); ++index) {
+            Id id = nonTreeEdges_[index];
+            Traits::random(&random_, numBits_, &edgesBits_[id]);
         }
     }
 
-    void xorBit(long long& bitset, size_t index)
+    // Levels of orderedVertices_ are processed one after another,
+    // vertices of a level in parallel.
+    void completeParallelBinaryCirculations()
     {
-        REQUIRE(index < 64, "Bitset index is out of range");
-        bitset ^= 1LL << index;
+        std::vector<Label> vertexDegreeParity(graph_.numVertices(),
+                                              Label());
+        EdgesRange edges = graph_.edges();
+        #pragma omp parallel for
+        for (size_t index = 0; index < nonTreeEdges_.size(); ++index) {
+            const Edge& edge = edges[nonTreeEdges_[index]];
+            Traits::atomicXor(&vertexDegreeParity[edge.first],
+                              edgesBits_[edge.id]);
+            Traits::atomicXor(&vertexDegreeParity[edge.second],
+                              edgesBits_[edge.id]);
+        }
+        for (size_t level = 0; level + 1 < levelOffsets_.size(); ++level) {
+            size_t begin = levelOffsets_[level];
+            size_t end = levelOffsets_[level + 1];
+            #pragma omp parallel for if(end - begin > PARALLEL_LEVEL_SIZE)
+            for (size_t index = begin; index < end; ++index) {
+                Id vertex = orderedVertices_[index];
+                if (vertex == root_) {
+                    checkBinaryCirculations(vertexDegreeParity);
+                } else {
+                    const Label& parity = vertexDegreeParity[vertex];
+                    const Arc& arc = rootedSpanningTreeParents_[vertex];
+                    edgesBits_[arc.id] ^= parity;
+                    Traits::atomicXor(&vertexDegreeParity[arc.to], parity);
+                }
+            }
+        }
     }
 
-    bool takeBit(long long bitset, size_t index)
+    // Every block of non-tree edges has its own generator, so labels
+    // do not depend on the number of threads.
+    void generateParallelUniRandPartialCirculations()
     {
-        REQUIRE(index < 64, "Bitset index is out of range");
-        return (bitset >> index) & 1;
+        static const size_t BLOCK_SIZE = 4096;
+        edgesBits_.assign(graph_.numEdges(), Label());
+        size_t numBlocks = (nonTreeEdges_.size() + BLOCK_SIZE - 1) /
+                           BLOCK_SIZE;
+        #pragma omp parallel for
+        for (size_t block = 0; block < numBlocks; ++block) {
+            Random generator((block + 1) * 0x9E3779B97F4A7C15ULL);
+            size_t end = std::min(nonTreeEdges_.size(),
+                                  (block + 1) * BLOCK_SIZE);
+            for (size_t index = block * BLOCK_SIZE; index < end; ++index) {
+                Traits::random(&generator, numBits_,
+                               &edgesBits_[nonTreeEdges_[index]]);
+            }
+        }
     }
 
-    void generateUniRandPartialCirculations()
+    void buildParallelRootedSpanningTree()
     {
-        edgesBits_.resize(graph_.numEdges());
-        for (size_t index = 0; index < nonTreeEdges_.size(); ++index) {
-            const Edge& edge = nonTreeEdges_[index];
-            for (size_t bit = 0; bit < numBits_; ++bit) {
-                edgesBits_[edge.id] <<= 1;
-                edgesBits_[edge.id] |= rand() & 1;
+        std::vector<char> isTreeEdge;
+        graph_.parallelSpanningTree(&isTreeEdge);
+        nonTreeEdges_.clear();
+        for (Id id = 0; id < isTreeEdge.size(); ++id) {
+            if (!isTreeEdge[id]) {
+                nonTreeEdges_.push_back(id);
+            }
+        }
+        buildParallelRootedTree(isTreeEdge);
+    }
+
+    // BFS expanding a whole level in parallel, vertices are claimed
+    // by atomic exchange of their used flags. Levels are stored from
+    // the deepest one to the root in orderedVertices_.
+    void buildParallelRootedTree(const std::vector<char>& isTreeEdge)
+    {
+        root_ = 0;
+        std::vector<std::atomic<char> > used(graph_.numVertices());
+        #pragma omp parallel for
+        for (size_t vertex = 0; vertex < used.size(); ++vertex) {
+            used[vertex].store(false, std::memory_order_relaxed);
+        }
+        used[root_] = true;
+        rootedSpanningTreeParents_.resize(graph_.numVertices());
+        std::vector<Ids> levels(1, Ids(1, root_));
+        while (!levels.back().empty()) {
+            const Ids& frontier = levels.back();
+            Ids next;
+            #pragma omp parallel if(frontier.size() > PARALLEL_LEVEL_SIZE)
+            {
+                Ids found;
+                #pragma omp for schedule(dynamic, 256) nowait
+                for (size_t index = 0; index < frontier.size(); ++index) {
+                    Id vertex = frontier[index];
+                    Graph::IncidentArcs arcs = graph_.incidentArcs(vertex);
+                    for (const Arc* arc = arcs.begin(); arc != arcs.end();
+                         ++arc) {
+                        if (isTreeEdge[arc->id] && !used[arc->to] &&
+                            !used[arc->to].exchange(true)) {
+                            rootedSpanningTreeParents_[arc->to] =
+                                                        Arc(vertex, arc->id);
+                            found.push_back(arc->to);
+                        }
+                    }
+                }
+                #pragma omp critical
+                next.insert(next.end(), found.begin(), found.end());
+            }
+            levels.push_back(Ids());
+            levels.back().swap(next);
+        }
+        orderedVertices_.clear();
+        levelOffsets_.assign(1, 0);
+        for (size_t level = levels.size(); level-- > 0; ) {
+            if (!levels[level].empty()) {
+                orderedVertices_.insert(orderedVertices_.end(),
+                                        levels[level].begin(),
+                                        levels[level].end());
+                levelOffsets_.push_back(orderedVertices_.size());
             }
         }
     }
 
     void buildRootedSpanningTree()
     {
-        std::pair<Edges, Edges> result = graph_.spanningTree();
-        nonTreeEdges_ = result.second;
-        Graph tree(graph_.numVertices(), result.first);
-        buildRootedTree(tree);
+        std::vector<char> isTreeEdge;
+        graph_.spanningTree(&isTreeEdge);
+        nonTreeEdges_.clear();
+        for (Id id = 0; id < isTreeEdge.size(); ++id) {
+            if (!isTreeEdge[id]) {
+                nonTreeEdges_.push_back(id);
+            }
+        }
+        buildRootedTree(isTreeEdge);
     }
 
-    void buildRootedTree(const Graph& tree)
+    // Roots the spanning tree by BFS over tree edges of the graph,
+    // the tree is kept as parent arcs of vertices.
+    void buildRootedTree(const std::vector<char>& isTreeEdge)
     {
         root_ = 0;
-        std::queue<Id> verticesQueue;
-        verticesQueue.push(root_);
-        std::vector<bool> used(tree.numVertices());
+        orderedVertices_.clear();
+        orderedVertices_.reserve(graph_.numVertices());
+        orderedVertices_.push_back(root_);
+        std::vector<char> used(graph_.numVertices());
         used[root_] = true;
-        rootedSpanningTreeParents_.resize(tree.numVertices());
-        while (!verticesQueue.empty()) {
-            Id vertex = verticesQueue.front();
-            orderedVertices_.push_back(vertex);
-            verticesQueue.pop();
-            const Graph::Arcs& arcs = tree.incidentArcs(vertex);
+        rootedSpanningTreeParents_.resize(graph_.numVertices());
+        for (size_t head = 0; head < orderedVertices_.size(); ++head) {
+            Id vertex = orderedVertices_[head];
+            Graph::IncidentArcs arcs = graph_.incidentArcs(vertex);
             for (size_t arcIndex = 0; arcIndex < arcs.size(); ++arcIndex) {
                 const Arc& arc = arcs[arcIndex];
-                if (!used[arc.to]) {
+                if (isTreeEdge[arc.id] && !used[arc.to]) {
                     rootedSpanningTreeParents_[arc.to] = Arc(vertex, arc.id);
                     used[arc.to] = true;
-                    verticesQueue.push(arc.to);
+                    orderedVertices_.push_back(arc.to);
                 }
             }
         }
@@ -316,22 +867,36 @@ public:
         return cutEdges_;
     }
 
+    const std::vector<Edges>& twoEdgeCuts() const
+    {
+        return twoEdgeCuts_;
+    }
+
     void setNumBits(size_t numBits)
     {
         numBits_ = numBits;
     }
 
 private:
+    // smaller levels are not worth starting threads
+    static const size_t PARALLEL_LEVEL_SIZE = 1024;
+
     const Graph& graph_;
     size_t numBits_;
-    std::vector<long long> edgesBits_;
+    Random random_;
+    std::vector<Label> edgesBits_;
     Graph::Arcs rootedSpanningTreeParents_;
     Id root_;
-    Edges nonTreeEdges_;
+    Ids nonTreeEdges_;
     Ids orderedVertices_;
+    Ids levelOffsets_;
     Edges cutEdges_;
+    std::vector<Edges> twoEdgeCuts_;
 };
 
+typedef BasicProbableEdgesCutSolver<uint64_t> ProbableEdgesCutSolver;
+typedef BasicProbableEdgesCutSolver<WideLabel> WideProbableEdgesCutSolver;
+
 class EdgesCutSolver
 {
 public:
@@ -347,22 +912,32 @@ public:
         dfs(0, UNDEFINED);
     }
 
+    // Depth-first search with explicit stack of frames, so its depth is
+    // not limited by the call stack. Visits vertices and finds bridges
+    // in the same order as the recursive search.
     void dfs(Id vertex, Id parent)
     {
-        up_[vertex] = id_[vertex] = timer_++;
-        used_[vertex] = true;
-        const Graph::IncidentArcs& arcs = graph_.incidentArcs(vertex);
-        for (size_t index = 0; index < arcs.size(); ++index) {
-            const Arc& arc = arcs[index];
-            if (arc.to != parent) {
+        std::vector<Frame> frames;
+        enter(vertex, &frames);
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            if (frame.next == frame.end) {
+                Id child = frame.vertex;
+                frames.pop_back();
+                if (!frames.empty()) {
+                    leave(child, frames.back());
+                }
+                continue;
+            }
+            const Arc& arc = *frame.next++;
+            Id current = frame.vertex;
+            Id currentParent = frames.size() > 1 ?
+                               frames[frames.size() - 2].vertex : parent;
+            if (arc.to != currentParent) {
                 if (used_[arc.to]) {
-                    up_[vertex] = std::min(up_[vertex], id_[arc.to]);
+                    up_[current] = std::min(up_[current], id_[arc.to]);
                 } else {
-                    dfs(arc.to, vertex);
-                    up_[vertex] = std::min(up_[vertex], up_[arc.to]);
-                    if (up_[arc.to] > id_[vertex]) {
-                        cutEdges_.push_back(graph_.edges()[arc.id]);
-                    }
+                    enter(arc.to, &frames);
                 }
             }
         }
@@ -374,14 +949,235 @@ public:
     }
 
 private:
+    // Vertex being visited and its arcs left to look through, the arc
+    // to the next frame vertex is the one before next.
+    struct Frame
+    {
+        Id vertex;
+        const Arc* next;
+        const Arc* end;
+    };
+
+    void enter(Id vertex, std::vector<Frame>* frames)
+    {
+        up_[vertex] = id_[vertex] = timer_++;
+        used_[vertex] = true;
+        Graph::IncidentArcs arcs = graph_.incidentArcs(vertex);
+        Frame frame = {vertex, arcs.begin(), arcs.end()};
+        frames->push_back(frame);
+    }
+
+    void leave(Id child, const Frame& parentFrame)
+    {
+        Id vertex = parentFrame.vertex;
+        up_[vertex] = std::min(up_[vertex], up_[child]);
+        if (up_[child] > id_[vertex]) {
+            cutEdges_.push_back(graph_.edges()[(parentFrame.next - 1)->id]);
+        }
+    }
+
     const Graph& graph_;
     Ids up_;
     Ids id_;
-    std::vector<bool> used_;
+    std::vector<char> used_;
     Id timer_;
     Edges cutEdges_;
 };
 
+// Keeps bridges of a growing graph. Vertices are grouped into
+// 2-edge-connected components by one union-find, components form
+// a forest which trees are grouped by another one. A new edge either
+// links two trees, rerooting the smaller one, and becomes a bridge, or
+// closes a cycle, and components on the cycle are fused with their
+// bridges. Each edge is processed in amortized O(log n) time.
+class IncrementalEdgesCutSolver
+{
+public:
+    explicit IncrementalEdgesCutSolver(size_t numVertices)
+        : componentIds_(numVertices), treeIds_(numVertices),
+        treeSizes_(numVertices, 1), parents_(numVertices, UNDEFINED),
+        parentEdges_(numVertices, UNDEFINED),
+        lastVisits_(numVertices, 0), iteration_(0), numCutEdges_(0)
+    {
+        for (Id vertex = 0; vertex < numVertices; ++vertex) {
+            componentIds_[vertex] = vertex;
+            treeIds_[vertex] = vertex;
+        }
+    }
+
+    void addEdge(const Edge& edge)
+    {
+        REQUIRE(edge.first < componentIds_.size() &&
+                edge.second < componentIds_.size(), "Vertex is out of range");
+        edges_.push_back(edge);
+        isCutEdge_.push_back(false);
+        Id first = componentId(edge.first);
+        Id second = componentId(edge.second);
+        if (first == second) {
+            return;
+        }
+        Id firstTree = treeId(first);
+        Id secondTree = treeId(second);
+        if (firstTree != secondTree) {
+            if (treeSizes_[firstTree] > treeSizes_[secondTree]) {
+                std::swap(first, second);
+                std::swap(firstTree, secondTree);
+            }
+            makeRoot(first);
+            parents_[first] = second;
+            parentEdges_[first] = edges_.size() - 1;
+            treeIds_[first] = second;
+            treeSizes_[secondTree] += treeSizes_[first];
+            isCutEdge_.back() = true;
+            ++numCutEdges_;
+            cutEdgesHeap_.push(std::make_pair(edge.weight,
+                                              edges_.size() - 1));
+        } else {
+            fusePath(first, second);
+        }
+    }
+
+    size_t numCutEdges() const
+    {
+        return numCutEdges_;
+    }
+
+    // Returns UNDEFINED if there are no bridges. Edges which stopped
+    // being bridges are dropped from the heap lazily.
+    size_t minCutEdgeWeight()
+    {
+        while (!cutEdgesHeap_.empty() &&
+               !isCutEdge_[cutEdgesHeap_.top().second]) {
+            cutEdgesHeap_.pop();
+        }
+        return cutEdgesHeap_.empty() ? UNDEFINED : cutEdgesHeap_.top().first;
+    }
+
+    Edges cutEdges() const
+    {
+        Edges result;
+        for (size_t index = 0; index < edges_.size(); ++index) {
+            if (isCutEdge_[index]) {
+                result.push_back(edges_[index]);
+            }
+        }
+        return result;
+    }
+
+private:
+    typedef std::pair<size_t, Id> WeightedEdge;
+
+    Id componentId(Id vertex)
+    {
+        Id root = vertex;
+        while (componentIds_[root] != root) {
+            root = componentIds_[root];
+        }
+        while (componentIds_[vertex] != root) {
+            Id next = componentIds_[vertex];
+            componentIds_[vertex] = root;
+            vertex = next;
+        }
+        return root;
+    }
+
+    // Links of trees may refer to fused components, so they are
+    // resolved to components at every step.
+    Id treeId(Id component)
+    {
+        component = componentId(component);
+        Id root = component;
+        while (treeIds_[root] != root) {
+            root = componentId(treeIds_[root]);
+        }
+        while (component != root) {
+            Id next = componentId(treeIds_[component]);
+            treeIds_[component] = root;
+            component = next;
+        }
+        return root;
+    }
+
+    // Reverses parent links on the way from component to its root,
+    // moving the bridges along.
+    void makeRoot(Id component)
+    {
+        Id root = component;
+        Id child = UNDEFINED;
+        Id childEdge = UNDEFINED;
+        while (component != UNDEFINED) {
+            Id parent = parents_[component] == UNDEFINED ?
+                        UNDEFINED : componentId(parents_[component]);
+            Id parentEdge = parentEdges_[component];
+            parents_[component] = child;
+            parentEdges_[component] = childEdge;
+            treeIds_[component] = root;
+            child = component;
+            childEdge = parentEdge;
+            component = parent;
+        }
+        treeSizes_[root] = treeSizes_[child];
+    }
+
+    // Fuses components on the tree path between first and second,
+    // walking up from both of them until paths meet.
+    void fusePath(Id first, Id second)
+    {
+        ++iteration_;
+        Ids firstPath;
+        Ids secondPath;
+        Id lca = UNDEFINED;
+        while (lca == UNDEFINED) {
+            if (first != UNDEFINED) {
+                first = climb(first, &firstPath, &lca);
+            }
+            if (lca == UNDEFINED && second != UNDEFINED) {
+                second = climb(second, &secondPath, &lca);
+            }
+        }
+        fuse(firstPath, lca);
+        fuse(secondPath, lca);
+    }
+
+    Id climb(Id component, Ids* path, Id* lca)
+    {
+        component = componentId(component);
+        path->push_back(component);
+        if (lastVisits_[component] == iteration_) {
+            *lca = component;
+            return UNDEFINED;
+        }
+        lastVisits_[component] = iteration_;
+        return parents_[component];
+    }
+
+    void fuse(const Ids& path, Id lca)
+    {
+        for (size_t index = 0; index < path.size(); ++index) {
+            Id component = path[index];
+            if (component == lca) {
+                break;
+            }
+            componentIds_[component] = lca;
+            isCutEdge_[parentEdges_[component]] = false;
+            --numCutEdges_;
+        }
+    }
+
+    Ids componentIds_;
+    Ids treeIds_;
+    Ids treeSizes_;
+    Ids parents_;
+    Ids parentEdges_;
+    std::vector<size_t> lastVisits_;
+    size_t iteration_;
+    Edges edges_;
+    std::vector<char> isCutEdge_;
+    size_t numCutEdges_;
+    std::priority_queue<WeightedEdge, std::vector<WeightedEdge>,
+                        std::greater<WeightedEdge> > cutEdgesHeap_;
+};
+
 Ids extractIdsSorted(const Edges& edges)
 {
     Ids result;
@@ -398,23 +1194,116 @@ bool checkSameEdges(const Edges& first, const Edges& second)
     return extractIdsSorted(first) == extractIdsSorted(second);
 }
 
-void solve(size_t numVertices, const Edges& edges)
+template <class Solver>
+Edges findCutEdges(Solver* solver, bool parallel)
+{
+    if (parallel) {
+        solver->solveParallel();
+    } else {
+        solver->solve();
+    }
+    return solver->cutEdges();
+}
+
+// Prints minimal weight of a bridge or -1. Wide labels of 256 bits
+// make false bridges much less probable than 64-bit ones.
+void solve(size_t numVertices, EdgesRange edges, bool parallel, bool wide)
 {
     Graph graph(numVertices, edges);
-    ProbableEdgesCutSolver solver(graph, 10);
-    solver.solve();
-    Edges cutEdges = solver.cutEdges();
+    Edges cutEdges;
+    if (wide) {
+        WideProbableEdgesCutSolver solver(graph, 256);
+        cutEdges = findCutEdges(&solver, parallel);
+    } else {
+        ProbableEdgesCutSolver solver(graph, 64);
+        cutEdges = findCutEdges(&solver, parallel);
+    }
     if (cutEdges.empty()) {
         std::cout << -1 << std::endl;
     } else {
         size_t minWeight = 1e9 + 111;
         for (size_t index = 0; index < cutEdges.size(); ++index) {
-            minWeight = std::min(minWeight, cutEdges[index].weight);
+            minWeight = std::min<size_t>(minWeight, cutEdges[index].weight);
+        }
+        std::cout << minWeight << std::endl;
+    }
+}
+
+// Prints minimal total weight of a 2-edge cut made of two non-bridge
+// edges and numbers of its edges, or -1 if there is no such cut.
+void solveTwoEdgeCuts(size_t numVertices, EdgesRange edges)
+{
+    Graph graph(numVertices, edges);
+    // collisions of labels are more probable among pairs of edges
+    WideProbableEdgesCutSolver solver(graph, 128);
+    solver.solveTwoEdgeCuts();
+    const std::vector<Edges>& cuts = solver.twoEdgeCuts();
+    const Edge* best[2] = {NULL, NULL};
+    for (size_t index = 0; index < cuts.size(); ++index) {
+        const Edge* lightest[2] = {&cuts[index][0], &cuts[index][1]};
+        if (lightest[1]->weight < lightest[0]->weight) {
+            std::swap(lightest[0], lightest[1]);
+        }
+        for (size_t edge = 2; edge < cuts[index].size(); ++edge) {
+            const Edge* current = &cuts[index][edge];
+            if (current->weight < lightest[0]->weight) {
+                lightest[1] = lightest[0];
+                lightest[0] = current;
+            } else if (current->weight < lightest[1]->weight) {
+                lightest[1] = current;
+            }
+        }
+        if (best[0] == NULL || lightest[0]->weight + lightest[1]->weight <
+                               best[0]->weight + best[1]->weight) {
+            best[0] = lightest[0];
+            best[1] = lightest[1];
         }
+    }
+    if (best[0] == NULL) {
+        std::cout << -1 << std::endl;
+    } else {
+        std::cout << best[0]->weight + best[1]->weight << " "
+                  << best[0]->id + 1 << " " << best[1]->id + 1 << std::endl;
+    }
+}
+
+void writeMinWeight(IncrementalEdgesCutSolver* solver)
+{
+    size_t minWeight = solver->minCutEdgeWeight();
+    if (minWeight == UNDEFINED) {
+        std::cout << -1 << std::endl;
+    } else {
         std::cout << minWeight << std::endl;
     }
 }
 
+// Prints minimal bridge weight of the graph, then reads batches of
+// new edges (their number followed by edges in the input format) and
+// prints minimal bridge weight after each one.
+void solveOnline(size_t numVertices, EdgesRange edges)
+{
+    IncrementalEdgesCutSolver solver(numVertices);
+    for (size_t index = 0; index < edges.size(); ++index) {
+        solver.addEdge(edges[index]);
+    }
+    writeMinWeight(&solver);
+    size_t batchSize;
+    Id nextId = edges.size();
+    while (std::cin >> batchSize) {
+        for (size_t index = 0; index < batchSize; ++index) {
+            Edge edge;
+            std::cin >> edge.first >> edge.second >> edge.weight;
+            REQUIRE(edge.first > 0 && edge.second > 0,
+                    "Vertices are numbered from 1");
+            --edge.first;
+            --edge.second;
+            edge.id = nextId++;
+            solver.addEdge(edge);
+        }
+        writeMinWeight(&solver);
+    }
+}
+
 void testWithRandomGraph()
 {
     size_t numVertices = rand() % 1000 + 10;
@@ -460,8 +1349,27 @@ void testWithRandomGraph()
     Graph graph(numVertices, edges);
     ProbableEdgesCutSolver psolver(graph, 60);
     psolver.solve();
+    WideProbableEdgesCutSolver wideSolver(graph, 256);
+    wideSolver.solve();
+    WideProbableEdgesCutSolver parallelSolver(graph, 256);
+    parallelSolver.solveParallel();
     EdgesCutSolver solver(graph);
     solver.solve();
+    IncrementalEdgesCutSolver incrementalSolver(numVertices);
+    for (size_t index = 0; index < edges.size(); ++index) {
+        incrementalSolver.addEdge(edges[index]);
+    }
+    if (!checkSameEdges(incrementalSolver.cutEdges(), solver.cutEdges())) {
+        std::cerr << "Cut edges provided by incremental solution "
+                  << "differ from ones provided by deterministic solution";
+        exit(1);
+    }
+    if (!checkSameEdges(wideSolver.cutEdges(), solver.cutEdges()) ||
+        !checkSameEdges(parallelSolver.cutEdges(), solver.cutEdges())) {
+        std::cerr << "Cut edges provided by wide probable solution "
+                  << "differ from ones provided by deterministic solution";
+        exit(1);
+    }
     if (!checkSameEdges(psolver.cutEdges(), solver.cutEdges())) {
         std::cerr << "Cut edges provided by probable solution "
                   << "differ from ones provided by deterministic solution";
@@ -482,7 +1390,204 @@ void testWithRandomGraph()
     }
 }
 
-int main()
+// Sorted path of a few million vertices: finds of the spanning tree
+// go along the whole path, they used to overflow the stack.
+void testWithSortedPath()
+{
+    size_t numVertices = 3000000;
+    Edges edges;
+    for (Id vertex = 0; vertex + 1 < numVertices; ++vertex) {
+        edges.push_back(Edge(vertex, vertex + 1, 1, vertex));
+    }
+    Graph graph(numVertices, edges);
+    ProbableEdgesCutSolver psolver(graph, 64);
+    psolver.solve();
+    EdgesCutSolver solver(graph);
+    solver.solve();
+    if (solver.cutEdges().size() != edges.size() ||
+        !checkSameEdges(psolver.cutEdges(), solver.cutEdges())) {
+        std::cerr << "Not all edges of the path are found as cut edges";
+        exit(1);
+    }
+}
+
+#ifdef BENCHMARK
+void addRandomEdge(Id first, Id second, Random* random, Edges* edges)
+{
+    if (first != second) {
+        Edge edge(std::min(first, second), std::max(first, second),
+                  random->next() % 1000000000, 0);
+        edges->push_back(edge);
+    }
+}
+
+// Connected graph where each vertex but the first is attached to
+// a random one of up to spread previous vertices, with numExtra more
+// random edges of length up to spread.
+void generateTreeLike(size_t numVertices, size_t spread, size_t numExtra,
+                      Random* random, Edges* edges)
+{
+    for (Id vertex = 1; vertex < numVertices; ++vertex) {
+        size_t length = random->next() % std::min(vertex, spread) + 1;
+        addRandomEdge(vertex - length, vertex, random, edges);
+    }
+    for (size_t index = 0; index < numExtra; ++index) {
+        Id first = random->next() % numVertices;
+        Id second = std::min(numVertices - 1,
+                             first + random->next() % spread);
+        addRandomEdge(first, second, random, edges);
+    }
+}
+
+void generateGrid(size_t side, Random* random, Edges* edges)
+{
+    for (Id row = 0; row < side; ++row) {
+        for (Id column = 0; column < side; ++column) {
+            Id vertex = row * side + column;
+            if (column + 1 < side) {
+                addRandomEdge(vertex, vertex + 1, random, edges);
+            }
+            if (row + 1 < side) {
+                addRandomEdge(vertex, vertex + side, random, edges);
+            }
+        }
+    }
+}
+
+// Drops multiple edges, which the deterministic solver does not
+// handle, shuffles edges and numbers them.
+void normalizeEdges(Random* random, Edges* edges)
+{
+    std::sort(edges->begin(), edges->end(),
+              [](const Edge& first, const Edge& second) {
+                  return std::make_pair(first.first, first.second) <
+                         std::make_pair(second.first, second.second);
+              });
+    edges->erase(std::unique(edges->begin(), edges->end(),
+                     [](const Edge& first, const Edge& second) {
+                         return first.first == second.first &&
+                                first.second == second.second;
+                     }), edges->end());
+    for (size_t index = edges->size(); index > 1; --index) {
+        std::swap((*edges)[index - 1], (*edges)[random->next() % index]);
+    }
+    for (size_t index = 0; index < edges->size(); ++index) {
+        (*edges)[index].id = index;
+    }
+}
+
+double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start).count();
+}
+
+// Times solvers on the graph and checks the probable one against
+// the deterministic one: it never misses a bridge, takes other edges
+// for bridges with probability 2^-numBits, and finds exactly the
+// bridges with 64 bits.
+void benchmark(const std::string& name, size_t numVertices,
+               const Edges& edges)
+{
+    Graph graph(numVertices, edges);
+    std::chrono::steady_clock::time_point start =
+                                        std::chrono::steady_clock::now();
+    EdgesCutSolver solver(graph);
+    solver.solve();
+    double seconds = elapsedSeconds(start);
+    Ids cutEdges = extractIdsSorted(solver.cutEdges());
+    size_t numOthers = edges.size() - cutEdges.size();
+    std::cout << name << ": " << numVertices << " vertices, "
+              << edges.size() << " edges, " << cutEdges.size()
+              << " bridges" << std::endl;
+    std::cout << "    deterministic: "
+              << static_cast<size_t>(edges.size() / seconds)
+              << " edges/s" << std::endl;
+    static const size_t NUM_BITS[] = {1, 2, 4, 8, 16, 32, 64};
+    for (size_t index = 0; index < sizeof(NUM_BITS) / sizeof(NUM_BITS[0]);
+         ++index) {
+        size_t numBits = NUM_BITS[index];
+        start = std::chrono::steady_clock::now();
+        ProbableEdgesCutSolver probableSolver(graph, numBits);
+        probableSolver.solve();
+        seconds = elapsedSeconds(start);
+        Ids probableCutEdges = extractIdsSorted(probableSolver.cutEdges());
+        REQUIRE(std::includes(probableCutEdges.begin(),
+                              probableCutEdges.end(),
+                              cutEdges.begin(), cutEdges.end()),
+                name << ": probable solver missed a bridge");
+        REQUIRE(numBits < 64 || probableCutEdges == cutEdges,
+                name << ": probable solver found false bridges");
+        size_t numErrors = probableCutEdges.size() - cutEdges.size();
+        std::cout << "    probable, " << numBits << " bits: "
+                  << static_cast<size_t>(edges.size() / seconds)
+                  << " edges/s, error rate "
+                  << (numOthers ? double(numErrors) / numOthers : 0.0)
+                  << " (expected " << std::pow(0.5, double(numBits)) << ")"
+                  << std::endl;
+    }
+}
+
+void benchmark(size_t numVertices)
+{
+    Random random;
+    Edges edges;
+    generateTreeLike(numVertices, numVertices, numVertices / 2, &random,
+                     &edges);
+    normalizeEdges(&random, &edges);
+    benchmark("sparse", numVertices, edges);
+
+    edges.clear();
+    size_t numDenseVertices = numVertices / 16;
+    generateTreeLike(numDenseVertices, numDenseVertices,
+                     numDenseVertices * 16, &random, &edges);
+    normalizeEdges(&random, &edges);
+    benchmark("dense", numDenseVertices, edges);
+
+    edges.clear();
+    generateTreeLike(numVertices, 64, numVertices / 64, &random, &edges);
+    normalizeEdges(&random, &edges);
+    benchmark("path", numVertices, edges);
+
+    edges.clear();
+    size_t side = std::sqrt(double(numVertices));
+    generateGrid(side, &random, &edges);
+    normalizeEdges(&random, &edges);
+    benchmark("grid", side * side, edges);
+}
+#endif
+
+struct Options
+{
+    Options()
+        : twoEdgeCuts(false), parallel(false), wide(false), online(false),
+        binary(false), convert(false) { }
+
+    bool twoEdgeCuts;
+    bool parallel;
+    // bridges are found with 256-bit labels
+    bool wide;
+    bool online;
+    // input is a binary edge list
+    bool binary;
+    // writes input as a binary edge list
+    bool convert;
+};
+
+void run(const Options& options, size_t numVertices, EdgesRange edges)
+{
+    if (options.convert) {
+        writeBinaryEdges(stdout, numVertices, edges);
+    } else if (options.online) {
+        solveOnline(numVertices, edges);
+    } else if (options.twoEdgeCuts) {
+        solveTwoEdgeCuts(numVertices, edges);
+    } else {
+        solve(numVertices, edges, options.parallel, options.wide);
+    }
+}
+
+int main(int argc, char** argv)
 {
     std::ios_base::sync_with_stdio(false);
 
@@ -490,11 +1595,46 @@ int main()
     for (size_t testIndex = 0; testIndex < 100; ++testIndex) {
         testWithRandomGraph();
     }
+    testWithSortedPath();
+#elif defined(BENCHMARK)
+    // number of vertices, up to 10^7 fit into a few gigabytes
+    benchmark(argc > 1 ? atol(argv[1]) : 1000000);
 #else
-    size_t numVertices;
-    Edges edges;
-    readData(numVertices, &edges);
-    solve(numVertices, to0Notation(edges));
+    Options options;
+    for (int index = 1; index < argc; ++index) {
+        std::string option = argv[index];
+        if (option == "--two-edge-cuts") {
+            options.twoEdgeCuts = true;
+        } else if (option == "--parallel") {
+            options.parallel = true;
+        } else if (option == "--wide") {
+            options.wide = true;
+        } else if (option == "--online") {
+            options.online = true;
+        } else if (option == "--binary") {
+            options.binary = true;
+        } else if (option == "--convert") {
+            options.convert = true;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (options.binary) {
+        // new edges of online mode are read from stdin
+        if (options.online) {
+            std::cerr << "Online mode needs text input" << std::endl;
+            return 1;
+        }
+        MappedEdgeList edgeList(STDIN_FILENO);
+        run(options, edgeList.numVertices(), edgeList.edges());
+    } else {
+        size_t numVertices;
+        Edges edges;
+        readData(numVertices, &edges);
+        to0Notation(&edges);
+        run(options, numVertices, edges);
+    }
 #endif
 
     return 0;
@@ -2,6 +2,11 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+#include <cstdlib>
+#include <stdint.h>
 
 #define REQUIRE(cond, message) \
     do { \
@@ -39,6 +44,37 @@ struct Arc
 typedef std::vector<Arc> Arcs;
 typedef std::vector<Arcs> Graph;
 
+// Contiguous sequence of vertices, which the range does not own.
+class IdsRange
+{
+public:
+    IdsRange(const Id* begin, const Id* end) : begin_(begin), end_(end) { }
+
+    size_t size() const
+    {
+        return end_ - begin_;
+    }
+
+    Id operator[](size_t index) const
+    {
+        return begin_[index];
+    }
+
+    const Id* begin() const
+    {
+        return begin_;
+    }
+
+    const Id* end() const
+    {
+        return end_;
+    }
+
+private:
+    const Id* begin_;
+    const Id* end_;
+};
+
 class Automaton {
 public:
     Automaton() : numVertices_(0), initVertex_(-1) { }
@@ -55,9 +91,12 @@ public:
             isTerminal_[terminals[index]] = true;
         }
     }
-    const Ids& next(Id vertex, char label) const
+    IdsRange next(Id vertex, char label) const
     {
-        return transitions_[vertex][getLabelId(label)];
+        size_t index = vertex * ALPH_NUM + getLabelId(label);
+        const Id* targets = transitionTargets_.data();
+        return IdsRange(targets + transitionOffsets_[index],
+                        targets + transitionOffsets_[index + 1]);
     }
 
     Id initVertex() const
@@ -100,15 +139,33 @@ public:
         return numVertices_;
     }
 
+    // Builds transitions in compressed sparse row form: targets of
+    // (vertex, label) occupy [offset, next offset) of one flat array,
+    // where offset is indexed by vertex * ALPH_NUM + label id.
     void buildTransitions()
     {
-        transitions_ = std::vector<std::vector<Ids> >(
-                                    numVertices_, std::vector<Ids>(ALPH_NUM));
+        transitionOffsets_.assign(numVertices_ * ALPH_NUM + 1, 0);
         for (Id vertex = 0; vertex < numVertices_; ++vertex) {
             const Arcs& arcs = graph_[vertex];
             for (size_t arcId = 0; arcId < arcs.size(); ++arcId) {
                 const Arc& arc = arcs[arcId];
-                transitions_[vertex][getLabelId(arc.label)].push_back(arc.to);
+                ++transitionOffsets_[vertex * ALPH_NUM +
+                                     getLabelId(arc.label) + 1];
+            }
+        }
+        for (size_t index = 0; index + 1 < transitionOffsets_.size();
+             ++index) {
+            transitionOffsets_[index + 1] += transitionOffsets_[index];
+        }
+        transitionTargets_.resize(transitionOffsets_.back());
+        Ids positions(transitionOffsets_.begin(),
+                      transitionOffsets_.end() - 1);
+        for (Id vertex = 0; vertex < numVertices_; ++vertex) {
+            const Arcs& arcs = graph_[vertex];
+            for (size_t arcId = 0; arcId < arcs.size(); ++arcId) {
+                const Arc& arc = arcs[arcId];
+                size_t index = vertex * ALPH_NUM + getLabelId(arc.label);
+                transitionTargets_[positions[index]++] = arc.to;
             }
         }
     }
@@ -127,6 +184,8 @@ private:
         }
     }
 
+    // Components are numbered by Kosaraju's algorithm in topological
+    // order, so epsilon arcs lead from smaller ids to greater ones.
     void rebuildGraph(int numComponents) {
         graph_ = std::vector<Arcs>(numComponents);
         for (size_t edgeId = 0; edgeId < edges_.size(); ++edgeId) {
@@ -134,6 +193,8 @@ private:
             edge.from = componentIndex_[edge.from];
             edge.to = componentIndex_[edge.to];
             if (edge.label != EPSILON || edge.from != edge.to) {
+                REQUIRE(edge.label != EPSILON || edge.from < edge.to,
+                        "Epsilon arcs are not in topological order");
                 graph_[edge.from].push_back(Arc(edge.to, edge.label));
             }
         }
@@ -176,7 +237,8 @@ private:
     Graph graph_;
     Ids verticesInOrder;
     Ids componentIndex_;
-    std::vector<std::vector<Ids> > transitions_;
+    Ids transitionOffsets_;
+    Ids transitionTargets_;
     std::vector<bool> isTerminal_;
     Ids verticesInOrder_;
     std::vector<bool> used_;
@@ -204,80 +266,90 @@ void readAutomaton(Automaton* automaton)
     *automaton = Automaton(numVertices, edges, terminals);
 }
 
+// Finds the longest substring of the word accepted by automaton which
+// epsilon arcs go from smaller vertices to greater ones. Tables are
+// indexed by position * numVertices + vertex.
 class LongestSubstringFinder
 {
 public:
     LongestSubstringFinder(const Automaton& automaton,
                            const std::string& word)
         : automaton_(automaton), word_(word),
-        longestPathLength_(automaton.numVertices(),
-                           std::vector<size_t>(word.size() + 1, UNDEFINED)),
-        nextVertex_(automaton.numVertices(),
-                    std::vector<size_t>(word.size() + 1, NON_EXISTENT)),
-        nextPosition_(automaton.numVertices(),
-                      std::vector<size_t>(word.size() + 1, NON_EXISTENT)),
+        numVertices_(automaton.numVertices()),
+        longestPathLength_(numVertices_ * (word.size() + 1)),
+        nextVertex_(numVertices_ * (word.size() + 1)),
+        nextIsLetter_(numVertices_ * (word.size() + 1)),
         calculated_(false)
     { }
 
     std::string find()
     {
         if (!calculated_) {
+            calculateLongestPathLengths();
             answer_ = restoreSubstring();
+            calculated_ = true;
         }
         return answer_;
     }
 
 private:
-    int longestPathLength(Id vertex, size_t position) {
-        if (longestPathLength_[vertex][position] != UNDEFINED) {
-            return longestPathLength_[vertex][position];
-        }
-
-        size_t result = NON_EXISTENT;
-        size_t nextVertex = NON_EXISTENT;
-        size_t nextPosition = NON_EXISTENT;
-        if (automaton_.isTerminal(vertex)) {
-            result = 0;
-        }
-        const Ids& epsAdjacent = automaton_.next(vertex, EPSILON);
-        for (size_t index = 0; index < epsAdjacent.size(); ++index) {
-            size_t candidateValue =
-                            longestPathLength(epsAdjacent[index], position);
-            if (candidateValue != NON_EXISTENT) {
-                if (result == NON_EXISTENT || result < candidateValue) {
-                    result = candidateValue;
-                    nextVertex = epsAdjacent[index];
-                    nextPosition = position;
+    size_t index(Id vertex, size_t position) const
+    {
+        return position * numVertices_ + vertex;
+    }
+
+    // Sweeps positions from the end of the word, vertices of a position
+    // from the greatest one, so both letter and epsilon arcs lead to
+    // calculated states. Ties are broken as by the first found path.
+    void calculateLongestPathLengths()
+    {
+        for (size_t position = word_.length() + 1; position-- > 0; ) {
+            for (Id vertex = numVertices_; vertex-- > 0; ) {
+                size_t result = NON_EXISTENT;
+                size_t nextVertex = NON_EXISTENT;
+                bool nextIsLetter = false;
+                if (automaton_.isTerminal(vertex)) {
+                    result = 0;
                 }
-            }
-        }
-        if (position < word_.length()) {
-            const Ids& adjacent = automaton_.next(vertex, word_[position]);
-            for (size_t index = 0; index < adjacent.size(); ++index) {
-                size_t candidateValue =
-                            longestPathLength(adjacent[index], position + 1);
-                if (candidateValue != NON_EXISTENT) {
-                    if (result == NON_EXISTENT ||
-                                                result < candidateValue + 1) {
-                        result = candidateValue + 1;
-                        nextVertex = adjacent[index];
-                        nextPosition = position + 1;
+                IdsRange epsAdjacent = automaton_.next(vertex, EPSILON);
+                for (size_t i = 0; i < epsAdjacent.size(); ++i) {
+                    size_t candidateValue =
+                        longestPathLength_[index(epsAdjacent[i], position)];
+                    if (candidateValue != NON_EXISTENT &&
+                        (result == NON_EXISTENT || result < candidateValue)) {
+                        result = candidateValue;
+                        nextVertex = epsAdjacent[i];
                     }
                 }
+                if (position < word_.length()) {
+                    IdsRange adjacent =
+                                automaton_.next(vertex, word_[position]);
+                    for (size_t i = 0; i < adjacent.size(); ++i) {
+                        size_t candidateValue = longestPathLength_[
+                                            index(adjacent[i], position + 1)];
+                        if (candidateValue != NON_EXISTENT &&
+                            (result == NON_EXISTENT ||
+                             result < candidateValue + 1)) {
+                            result = candidateValue + 1;
+                            nextVertex = adjacent[i];
+                            nextIsLetter = true;
+                        }
+                    }
+                }
+                size_t current = index(vertex, position);
+                longestPathLength_[current] = result;
+                nextVertex_[current] = nextVertex;
+                nextIsLetter_[current] = nextIsLetter;
             }
         }
-
-        nextVertex_[vertex][position] = nextVertex;
-        nextPosition_[vertex][position] = nextPosition;
-        return longestPathLength_[vertex][position] = result;
     }
 
     std::string restoreSubstring() {
         size_t maxLength = 0;
         size_t argMaxPosition = 0;
         for (size_t position = 0; position < word_.length(); ++position) {
-            size_t pathLength =
-                        longestPathLength(automaton_.initVertex(), position);
+            size_t pathLength = longestPathLength_[
+                                index(automaton_.initVertex(), position)];
             if (pathLength != NON_EXISTENT && maxLength < pathLength) {
                 maxLength = pathLength;
                 argMaxPosition = position;
@@ -287,13 +359,13 @@ private:
         if (maxLength > 0) {
             Id vertex = automaton_.initVertex();
             Id position = argMaxPosition;
-            while (nextVertex_[vertex][position] != NON_EXISTENT) {
-                if (position + 1 == nextPosition_[vertex][position]) {
+            while (nextVertex_[index(vertex, position)] != NON_EXISTENT) {
+                size_t current = index(vertex, position);
+                vertex = nextVertex_[current];
+                if (nextIsLetter_[current]) {
                     result += word_[position];
+                    ++position;
                 }
-                Id newVertex = nextVertex_[vertex][position];
-                position = nextPosition_[vertex][position];
-                vertex = newVertex;
             }
         }
         REQUIRE(result.length() == maxLength,
@@ -303,48 +375,563 @@ private:
 
     const Automaton& automaton_;
     const std::string& word_;
-    std::vector<std::vector<size_t> > longestPathLength_;
-    std::vector<std::vector<Id> > nextVertex_;
-    std::vector<std::vector<size_t> > nextPosition_;
+    size_t numVertices_;
+    std::vector<size_t> longestPathLength_;
+    Ids nextVertex_;
+    std::vector<char> nextIsLetter_;
     std::string answer_;
     bool calculated_;
 };
 
-void readData(Automaton* automaton, std::string* word)
+// Automaton working on sets of states kept as bitsets: masks of
+// letter transitions are closed under epsilon arcs, so a set closed
+// under them is stepped by a union of masks of its states.
+class StateSetAutomaton
+{
+public:
+    typedef uint64_t Word;
+    typedef std::vector<Word> Words;
+
+    static const size_t NUM_LETTERS = Automaton::ALPH_NUM - 1;
+
+    // Automaton should have epsilon arcs in topological order.
+    explicit StateSetAutomaton(const Automaton& automaton)
+        : numVertices_(automaton.numVertices()),
+        numWords_((numVertices_ + 63) / 64),
+        letterMasks_(numVertices_ * NUM_LETTERS * numWords_),
+        terminals_(numWords_), initial_(numWords_)
+    {
+        Words closures(numVertices_ * numWords_);
+        for (Id vertex = numVertices_; vertex-- > 0; ) {
+            Word* closure = &closures[vertex * numWords_];
+            setBit(closure, vertex);
+            IdsRange adjacent = automaton.next(vertex, EPSILON);
+            for (size_t index = 0; index < adjacent.size(); ++index) {
+                unite(closure, &closures[adjacent[index] * numWords_]);
+            }
+            if (automaton.isTerminal(vertex)) {
+                setBit(&terminals_[0], vertex);
+            }
+        }
+        for (Id vertex = 0; vertex < numVertices_; ++vertex) {
+            for (size_t letter = 0; letter < NUM_LETTERS; ++letter) {
+                IdsRange adjacent = automaton.next(vertex, 'a' + letter);
+                for (size_t index = 0; index < adjacent.size(); ++index) {
+                    unite(&letterMasks_[maskIndex(vertex, letter)],
+                          &closures[adjacent[index] * numWords_]);
+                }
+            }
+        }
+        std::copy(&closures[automaton.initVertex() * numWords_],
+                  &closures[(automaton.initVertex() + 1) * numWords_],
+                  initial_.begin());
+    }
+
+    size_t numWords() const
+    {
+        return numWords_;
+    }
+
+    // closure of the initial vertex
+    const Words& initial() const
+    {
+        return initial_;
+    }
+
+    // Letter id is character - 'a', any other id leads to empty set.
+    void step(const Word* states, size_t letter, Word* result) const
+    {
+        std::fill(result, result + numWords_, 0);
+        if (letter >= NUM_LETTERS) {
+            return;
+        }
+        for (size_t index = 0; index < numWords_; ++index) {
+            for (Word bits = states[index]; bits != 0; bits &= bits - 1) {
+                Id vertex = index * 64 + __builtin_ctzll(bits);
+                unite(result, &letterMasks_[maskIndex(vertex, letter)]);
+            }
+        }
+    }
+
+    bool accepts(const Word* states) const
+    {
+        for (size_t index = 0; index < numWords_; ++index) {
+            if (states[index] & terminals_[index]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const Word* terminals() const
+    {
+        return &terminals_[0];
+    }
+
+private:
+    size_t maskIndex(Id vertex, size_t letter) const
+    {
+        return (vertex * NUM_LETTERS + letter) * numWords_;
+    }
+
+    void unite(Word* target, const Word* source) const
+    {
+        for (size_t index = 0; index < numWords_; ++index) {
+            target[index] |= source[index];
+        }
+    }
+
+    static void setBit(Word* words, Id bit)
+    {
+        words[bit / 64] |= Word(1) << (bit % 64);
+    }
+
+    size_t numVertices_;
+    size_t numWords_;
+    // closure of letter targets by vertex and letter
+    Words letterMasks_;
+    Words terminals_;
+    Words initial_;
+};
+
+// Simulates automaton from all start positions at once in one pass
+// over the word. States active for a start form a bitset lane, lanes
+// are ordered by start. A state active in an earlier lane is dropped
+// from later ones: whatever is accepted from it later is longer when
+// counted from the earlier start, so the answer stays exact and lanes
+// hold disjoint states. A step costs O(V / 64) per active state.
+class BitParallelSubstringFinder
+{
+public:
+    explicit BitParallelSubstringFinder(const StateSetAutomaton& automaton)
+        : automaton_(automaton), seen_(automaton.numWords()),
+        next_(automaton.numWords())
+    {
+    }
+
+    // Returns the longest accepted substring, the first one of them.
+    // Buffers are kept between calls.
+    std::string find(const std::string& word)
+    {
+        size_t numWords = automaton_.numWords();
+        const Word* terminals = automaton_.terminals();
+        Ids& starts = starts_;
+        Words& lanes = lanes_;
+        Words& seen = seen_;
+        Words& next = next_;
+        starts.clear();
+        lanes.clear();
+        size_t bestLength = 0;
+        size_t bestStart = 0;
+        for (size_t position = 0; position < word.length(); ++position) {
+            starts.push_back(position);
+            lanes.insert(lanes.end(), automaton_.initial().begin(),
+                         automaton_.initial().end());
+            size_t letter = word[position] - 'a';
+            std::fill(seen.begin(), seen.end(), 0);
+            size_t numLanes = 0;
+            for (size_t lane = 0; lane < starts.size(); ++lane) {
+                automaton_.step(&lanes[lane * numWords], letter, &next[0]);
+                Word active = 0;
+                Word accepted = 0;
+                for (size_t index = 0; index < numWords; ++index) {
+                    next[index] &= ~seen[index];
+                    seen[index] |= next[index];
+                    active |= next[index];
+                    accepted |= next[index] & terminals[index];
+                }
+                if (active == 0) {
+                    continue;
+                }
+                if (accepted != 0 &&
+                    position + 1 - starts[lane] > bestLength) {
+                    bestLength = position + 1 - starts[lane];
+                    bestStart = starts[lane];
+                }
+                std::copy(next.begin(), next.end(),
+                          &lanes[numLanes * numWords]);
+                starts[numLanes++] = starts[lane];
+            }
+            starts.resize(numLanes);
+            lanes.resize(numLanes * numWords);
+        }
+        return word.substr(bestStart, bestLength);
+    }
+
+private:
+    typedef StateSetAutomaton::Word Word;
+    typedef StateSetAutomaton::Words Words;
+
+    const StateSetAutomaton& automaton_;
+    Ids starts_;
+    Words lanes_;
+    Words seen_;
+    Words next_;
+};
+
+// Deterministic automaton built by subset construction on demand:
+// a set of states gets an id when it is first reached, and its
+// transitions are found when first taken. The cache is flushed when
+// it exceeds its size, which starts a new generation of ids. Dead and
+// initial sets always have the same ids.
+class LazyDfa
+{
+public:
+    typedef uint32_t State;
+
+    static const State DEAD_STATE = 0;
+    static const State INITIAL_STATE = 1;
+    static const size_t DEFAULT_CACHE_SIZE = 64 << 20;
+
+    explicit LazyDfa(const StateSetAutomaton& automaton,
+                     size_t cacheSize = DEFAULT_CACHE_SIZE)
+        : automaton_(automaton), numWords_(automaton.numWords()),
+        maxNumStates_(std::max<size_t>(cacheSize / stateSize(), 3)),
+        next_(numWords_), generation_(0), numFlushes_(0)
+    {
+        flush();
+        numFlushes_ = 0;
+    }
+
+    State next(State state, size_t letter)
+    {
+        if (letter >= StateSetAutomaton::NUM_LETTERS) {
+            return DEAD_STATE;
+        }
+        State& transition = transitions_[transitionIndex(state, letter)];
+        if (transition != UNKNOWN) {
+            return transition;
+        }
+        automaton_.step(&sets_[state * numWords_], letter, &next_[0]);
+        if (states_.size() == maxNumStates_ &&
+            states_.find(next_) == states_.end()) {
+            flush();
+            return addState(next_);
+        }
+        State result = addState(next_);
+        transitions_[transitionIndex(state, letter)] = result;
+        return result;
+    }
+
+    bool isAccepting(State state) const
+    {
+        return accepting_[state];
+    }
+
+    // Ids of states of different generations are not comparable.
+    size_t generation() const
+    {
+        return generation_;
+    }
+
+    size_t numFlushes() const
+    {
+        return numFlushes_;
+    }
+
+private:
+    typedef StateSetAutomaton::Word Word;
+    typedef StateSetAutomaton::Words Words;
+
+    static const State UNKNOWN = -1;
+
+    struct WordsHash
+    {
+        size_t operator()(const Words& words) const
+        {
+            uint64_t result = words.size();
+            for (size_t index = 0; index < words.size(); ++index) {
+                result = (result ^ words[index]) * 0x9E3779B97F4A7C15ULL;
+                result ^= result >> 29;
+            }
+            return result;
+        }
+    };
+
+    // approximate memory taken by a state: its set, transitions
+    // and hash table entry with a copy of the set
+    size_t stateSize() const
+    {
+        return 2 * numWords_ * sizeof(Word) +
+               StateSetAutomaton::NUM_LETTERS * sizeof(State) + 64;
+    }
+
+    size_t transitionIndex(State state, size_t letter) const
+    {
+        return state * StateSetAutomaton::NUM_LETTERS + letter;
+    }
+
+    // Returns id of the set, adding it if it is new.
+    State addState(const Words& set)
+    {
+        std::pair<std::unordered_map<Words, State, WordsHash>::iterator,
+                  bool> inserted = states_.insert(
+                                    std::make_pair(set, State(states_.size())));
+        if (inserted.second) {
+            sets_.insert(sets_.end(), set.begin(), set.end());
+            transitions_.resize(transitions_.size() +
+                                StateSetAutomaton::NUM_LETTERS,
+                                State(UNKNOWN));
+            accepting_.push_back(automaton_.accepts(&set[0]));
+        }
+        return inserted.first->second;
+    }
+
+    void flush()
+    {
+        states_.clear();
+        sets_.clear();
+        transitions_.clear();
+        accepting_.clear();
+        addState(Words(numWords_));
+        addState(automaton_.initial());
+        ++generation_;
+        ++numFlushes_;
+    }
+
+    const StateSetAutomaton& automaton_;
+    size_t numWords_;
+    size_t maxNumStates_;
+    std::unordered_map<Words, State, WordsHash> states_;
+    // sets of states by id
+    Words sets_;
+    std::vector<State> transitions_;
+    std::vector<char> accepting_;
+    Words next_;
+    size_t generation_;
+    size_t numFlushes_;
+};
+
+// Runs the lazy DFA from every start position, each run from its
+// start to the dead state. A run stops early where an earlier one
+// was in the same state at the same position, the earlier start
+// accepts all the same words and they are longer. Starts stop when
+// the rest of the word is not longer than the answer.
+class LazyDfaSubstringFinder
 {
-    readAutomaton(automaton);
-    std::cin >> *word;
+public:
+    explicit LazyDfaSubstringFinder(LazyDfa* dfa) : dfa_(dfa)
+    {
+    }
+
+    // Returns the longest accepted substring, the first one of them.
+    // Buffers are kept between calls.
+    std::string find(const std::string& word)
+    {
+        std::vector<LazyDfa::State>& visitedStates = visitedStates_;
+        std::vector<size_t>& visitedGenerations = visitedGenerations_;
+        visitedStates.resize(word.length() + 1);
+        visitedGenerations.assign(word.length() + 1, 0);
+        size_t bestLength = 0;
+        size_t bestStart = 0;
+        for (size_t start = 0; start + bestLength < word.length();
+             ++start) {
+            LazyDfa::State state = LazyDfa::INITIAL_STATE;
+            for (size_t position = start; position < word.length();
+                 ++position) {
+                state = dfa_->next(state, word[position] - 'a');
+                if (state == LazyDfa::DEAD_STATE) {
+                    break;
+                }
+                if (dfa_->isAccepting(state) &&
+                    position + 1 - start > bestLength) {
+                    bestLength = position + 1 - start;
+                    bestStart = start;
+                }
+                if (visitedGenerations[position + 1] == dfa_->generation() &&
+                    visitedStates[position + 1] == state) {
+                    break;
+                }
+                visitedStates[position + 1] = state;
+                visitedGenerations[position + 1] = dfa_->generation();
+            }
+        }
+        return word.substr(bestStart, bestLength);
+    }
+
+private:
+    LazyDfa* dfa_;
+    std::vector<LazyDfa::State> visitedStates_;
+    std::vector<size_t> visitedGenerations_;
+};
+
+enum Engine
+{
+    // dynamic programming over (state, position) tables
+    DYNAMIC_PROGRAMMING,
+    BIT_PARALLEL,
+    LAZY_DFA
+};
+
+// Finds answers for words by the engine, keeping buffers and cache
+// of the lazy DFA between words. Matchers of different threads may
+// share the automata.
+class WordMatcher
+{
+public:
+    // StateSetAutomaton is not needed for dynamic programming, cache
+    // size bounds memory of the lazy DFA states.
+    WordMatcher(const Automaton& automaton,
+                const StateSetAutomaton* stateSetAutomaton, Engine engine,
+                size_t cacheSize)
+        : automaton_(automaton), engine_(engine)
+    {
+        if (engine == LAZY_DFA) {
+            dfa_.reset(new LazyDfa(*stateSetAutomaton, cacheSize));
+            lazyDfaFinder_.reset(new LazyDfaSubstringFinder(dfa_.get()));
+        } else if (engine == BIT_PARALLEL) {
+            bitParallelFinder_.reset(
+                            new BitParallelSubstringFinder(*stateSetAutomaton));
+        }
+    }
+
+    std::string find(const std::string& word)
+    {
+        if (engine_ == LAZY_DFA) {
+            return lazyDfaFinder_->find(word);
+        } else if (engine_ == BIT_PARALLEL) {
+            return bitParallelFinder_->find(word);
+        } else {
+            LongestSubstringFinder solver(automaton_, word);
+            return solver.find();
+        }
+    }
+
+private:
+    const Automaton& automaton_;
+    Engine engine_;
+    std::unique_ptr<LazyDfa> dfa_;
+    std::unique_ptr<LazyDfaSubstringFinder> lazyDfaFinder_;
+    std::unique_ptr<BitParallelSubstringFinder> bitParallelFinder_;
+};
+
+std::unique_ptr<StateSetAutomaton> buildStateSetAutomaton(
+                                const Automaton& automaton, Engine engine)
+{
+    std::unique_ptr<StateSetAutomaton> result;
+    if (engine != DYNAMIC_PROGRAMMING) {
+        result.reset(new StateSetAutomaton(automaton));
+    }
+    return result;
 }
 
 void solve(const Automaton& automaton, const std::string& word,
-           std::string* result)
+           Engine engine, size_t cacheSize, std::string* result)
 {
-    LongestSubstringFinder solver(automaton, word);
-    *result = solver.find();
+    std::unique_ptr<StateSetAutomaton> stateSetAutomaton =
+                                buildStateSetAutomaton(automaton, engine);
+    WordMatcher matcher(automaton, stateSetAutomaton.get(), engine,
+                        cacheSize);
+    *result = matcher.find(word);
 }
 
-void writeData(const std::string& answer)
+void writeData(std::ostream& output, const std::string& answer)
 {
     if (answer.empty()) {
-        std::cout << "No solution" << std::endl;
+        output << "No solution\n";
     } else {
-        std::cout << answer << std::endl;
+        output << answer << '\n';
     }
 }
 
-int main()
+// Reads words until the end of input and writes their answers in
+// the same order. Words are read by batches, words of a batch are
+// matched by all threads, each with its own matcher. The cache size
+// is shared by all threads.
+void solveBatch(const Automaton& automaton, Engine engine, size_t cacheSize,
+                std::istream& input, std::ostream& output)
 {
-    Automaton automaton;
-    std::string word;
-    readData(&automaton, &word);
+    static const size_t BATCH_SIZE = 1 << 12;
+    std::unique_ptr<StateSetAutomaton> stateSetAutomaton =
+                                buildStateSetAutomaton(automaton, engine);
+    std::vector<std::string> words;
+    std::vector<std::string> answers;
+    size_t numThreads = 0;
+    #pragma omp parallel
+    {
+        #pragma omp atomic
+        ++numThreads;
+        #pragma omp barrier
+        WordMatcher matcher(automaton, stateSetAutomaton.get(), engine,
+                            cacheSize / numThreads);
+        while (true) {
+            #pragma omp single
+            {
+                words.clear();
+                std::string word;
+                while (words.size() < BATCH_SIZE && input >> word) {
+                    words.push_back(word);
+                }
+                answers.assign(words.size(), std::string());
+            }
+            if (words.empty()) {
+                break;
+            }
+            #pragma omp for schedule(dynamic, 16)
+            for (size_t index = 0; index < words.size(); ++index) {
+                answers[index] = matcher.find(words[index]);
+            }
+            #pragma omp single
+            for (size_t index = 0; index < answers.size(); ++index) {
+                writeData(output, answers[index]);
+            }
+        }
+    }
+}
 
+int main(int argc, char** argv)
+{
+    Engine engine = BIT_PARALLEL;
+    size_t cacheSize = LazyDfa::DEFAULT_CACHE_SIZE;
+    bool batch = false;
+    std::string wordsFile;
+    for (int index = 1; index < argc; ++index) {
+        std::string option = argv[index];
+        if (option == "--batch") {
+            batch = true;
+        } else if (option.compare(0, 8, "--words=") == 0) {
+            batch = true;
+            wordsFile = option.substr(8);
+        } else if (option.compare(0, 8, "--cache=") == 0) {
+            cacheSize = atol(option.c_str() + 8);
+        } else if (option == "--dp") {
+            engine = DYNAMIC_PROGRAMMING;
+        } else if (option == "--lazy-dfa") {
+            engine = LAZY_DFA;
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::ios_base::sync_with_stdio(false);
+
+    Automaton automaton;
+    readAutomaton(&automaton);
     automaton.shrinkByEpsilonArcs();
     automaton.buildTransitions();
 
-    std::string answer;
-    solve(automaton, word, &answer);
+    if (!batch) {
+        std::string word;
+        std::cin >> word;
 
-    writeData(answer);
+        std::string answer;
+        solve(automaton, word, engine, cacheSize, &answer);
+
+        writeData(std::cout, answer);
+        return 0;
+    }
+
+    if (wordsFile.empty()) {
+        solveBatch(automaton, engine, cacheSize, std::cin, std::cout);
+    } else {
+        std::ifstream words(wordsFile.c_str());
+        if (!words) {
+            std::cerr << "Cannot open " << wordsFile << std::endl;
+            return 1;
+        }
+        solveBatch(automaton, engine, cacheSize, words, std::cout);
+    }
 
     return 0;
 }